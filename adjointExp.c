@@ -0,0 +1,163 @@
+/* file : adjointExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Reverse mode automatic differentiation of a compiled expression (see bytecodeExp.c). Instead of
+  building derivative trees with differentiate and evaluating those, a forward sweep stores the
+  value of every instruction on a tape and a backward sweep propagates the adjoints from the
+  result to the operands. This gives the value and the partial derivatives to all slots at once,
+  in time linear in the length of the program. The operands of every instruction are looked up
+  once when the tape is made, so a tape can be run for any number of bindings without allocating.
+  The values are computed as runProgram computes them, so they are bit-identical.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "bytecodeExp.h"
+#include "adjointExp.h"
+
+// Makes a tape for the program, left[i] and right[i] are the instructions that computed the
+// operands of instruction i. The program must not change while the tape is used
+Tape newTape(Program *pp) {
+  Tape tp;
+  int n = pp->length > 0 ? pp->length : 1;
+  tp.program = pp;
+  tp.left = malloc(n * sizeof(int));
+  tp.right = malloc(n * sizeof(int));
+  tp.values = malloc(n * sizeof(double));
+  tp.adjoints = malloc(n * sizeof(double));
+  int *stack = malloc((pp->maxDepth + 1) * sizeof(int));
+  assert(tp.left != NULL && tp.right != NULL && tp.values != NULL && tp.adjoints != NULL && stack != NULL);
+  //The evaluation stack is simulated with instruction indices instead of values
+  int top = 0;
+  for (int i = 0; i < pp->length; i++) {
+    if (pp->code[i].op == OpNumber || pp->code[i].op == OpVariable) {
+      tp.left[i] = -1;
+      tp.right[i] = -1;
+      stack[top] = i;
+      top++;
+    } else {
+      tp.right[i] = stack[top - 1];
+      tp.left[i] = stack[top - 2];
+      top--;
+      stack[top - 1] = i;
+    }
+  }
+  free(stack);
+  return tp;
+}
+
+// Runs the forward sweep with the value of slot i in vars[i]
+static void forwardSweep(Tape *tp, const double *vars) {
+  const Instruction *code = tp->program->code;
+  double *v = tp->values;
+  for (int i = 0; i < tp->program->length; i++) {
+    switch (code[i].op) {
+      case OpNumber:
+        v[i] = code[i].number;
+        break;
+      case OpVariable:
+        v[i] = vars[code[i].slot];
+        break;
+      case OpAdd:
+        v[i] = v[tp->left[i]] + v[tp->right[i]];
+        break;
+      case OpSub:
+        v[i] = v[tp->left[i]] - v[tp->right[i]];
+        break;
+      case OpMul:
+        v[i] = v[tp->left[i]] * v[tp->right[i]];
+        break;
+      case OpDiv:
+        v[i] = v[tp->left[i]] / v[tp->right[i]];
+        break;
+    }
+  }
+}
+
+// Runs the backward sweep and adds the adjoint of every variable instruction to grad[slot]
+static void backwardSweep(Tape *tp, double *grad) {
+  const Instruction *code = tp->program->code;
+  const double *v = tp->values;
+  double *a = tp->adjoints;
+  int n = tp->program->length;
+  memset(a, 0, n * sizeof(double));
+  a[n - 1] = 1;
+  for (int i = n - 1; i >= 0; i--) {
+    int l = tp->left[i], r = tp->right[i];
+    switch (code[i].op) {
+      case OpNumber:
+        break;
+      case OpVariable:
+        grad[code[i].slot] += a[i];
+        break;
+      case OpAdd:
+        a[l] += a[i];
+        a[r] += a[i];
+        break;
+      case OpSub:
+        a[l] += a[i];
+        a[r] -= a[i];
+        break;
+      case OpMul:
+        a[l] += a[i] * v[r];
+        a[r] += a[i] * v[l];
+        break;
+      case OpDiv:
+        //(l/r)' = l'/r - l*r'/(r*r)
+        a[l] += a[i] / v[r];
+        a[r] -= a[i] * v[l] / (v[r] * v[r]);
+        break;
+    }
+  }
+}
+
+// Evaluates the program with the value of slot i in vars[i]. Returns the value of the expression
+// and stores its partial derivative to slot i in grad[i]
+double gradientProgram(Tape *tp, const double *vars, double *grad) {
+  int n = tp->program->length;
+  memset(grad, 0, tp->program->nameCount * sizeof(double));
+  if (n == 0) {
+    return 0;
+  }
+  forwardSweep(tp, vars);
+  backwardSweep(tp, grad);
+  return tp->values[n - 1];
+}
+
+// Evaluates the program for rows rows, slot i has the values columns[i]. The value of row r is
+// stored in values[r] and its partial derivative to slot i in grads[i][r]. The tape is reused
+// for all rows
+void gradientRows(Tape *tp, const double **columns, int rows, double *values, double **grads) {
+  int nVars = tp->program->nameCount;
+  double *vars = calloc(nVars + 1, sizeof(double));
+  double *grad = malloc((nVars + 1) * sizeof(double));
+  assert(vars != NULL && grad != NULL);
+  for (int r = 0; r < rows; r++) {
+    for (int i = 0; i < nVars; i++) {
+      vars[i] = columns[i][r];
+    }
+    values[r] = gradientProgram(tp, vars, grad);
+    for (int i = 0; i < nVars; i++) {
+      grads[i][r] = grad[i];
+    }
+  }
+  free(vars);
+  free(grad);
+}
+
+// Frees up the allocated space, the program is not freed
+void freeTape(Tape *tp) {
+  free(tp->left);
+  free(tp->right);
+  free(tp->values);
+  free(tp->adjoints);
+  tp->program = NULL;
+}
@@ -0,0 +1,19 @@
+#ifndef ADJOINTEXP_H
+#define ADJOINTEXP_H
+
+#include "bytecodeExp.h"
+
+typedef struct Tape {
+  Program *program;
+  int *left;
+  int *right;
+  double *values;
+  double *adjoints;
+} Tape;
+
+Tape newTape(Program *pp);
+double gradientProgram(Tape *tp, const double *vars, double *grad);
+void gradientRows(Tape *tp, const double **columns, int rows, double *values, double **grads);
+void freeTape(Tape *tp);
+
+#endif
@@ -0,0 +1,158 @@
+/* file : arenaExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Node arena for the expression trees built by infixExp.c. Nodes are handed out from large
+  blocks, so building, duplicating, differentiating and simplifying a tree costs no malloc per
+  node, and all nodes of one expression are released at once by resetting the arena.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "instrumentExp.h"
+#include "budgetExp.h"
+
+// The arena new nodes are taken from, NULL means every node is malloc'ed on its own.
+// Every thread has its own active arena
+static _Thread_local NodeArena *activeArena = NULL;
+// Counts the nodes the thread malloc'ed one by one because no arena was active
+static _Thread_local long nodeMallocs = 0;
+
+// Creates an empty arena, the first block is allocated on the first request
+NodeArena newArena() {
+  NodeArena ar;
+  ar.first = NULL;
+  ar.current = NULL;
+  ar.nodeCount = 0;
+  ar.blockMallocs = 0;
+  return ar;
+}
+
+// Appends a new block after the current one
+static void growArena(NodeArena *ap) {
+  ArenaBlock *block = malloc(sizeof(ArenaBlock));
+  assert(block != NULL);
+  block->next = NULL;
+  block->used = 0;
+  ap->blockMallocs++;
+  if (ap->current == NULL) {
+    ap->first = block;
+  } else {
+    ap->current->next = block;
+  }
+  ap->current = block;
+}
+
+// Takes a node from the arena and fills it in
+ExpTree arenaNode(NodeArena *ap, TokenType tt, Token t, ExpTree tL, ExpTree tR) {
+  if (ap->current == NULL) {
+    growArena(ap);
+  } else if (ap->current->used == ARENA_BLOCK_NODES) {
+    //Blocks kept from before the last reset are reused before a new one is malloc'ed
+    if (ap->current->next != NULL) {
+      ap->current = ap->current->next;
+      ap->current->used = 0;
+    } else {
+      growArena(ap);
+    }
+  }
+  ExpTree new = &ap->current->nodes[ap->current->used];
+  ap->current->used++;
+  ap->nodeCount++;
+  new->tt = tt;
+  new->t = t;
+  new->left = tL;
+  new->right = tR;
+  return new;
+}
+
+// Releases every node of the arena at once, the blocks are kept for reuse
+void resetArena(NodeArena *ap) {
+  ap->current = ap->first;
+  if (ap->current != NULL) {
+    ap->current->used = 0;
+  }
+  INSTR_ADD(nodeFrees, ap->nodeCount);
+  ap->nodeCount = 0;
+}
+
+// Frees the blocks of the arena
+void freeArena(NodeArena *ap) {
+  ArenaBlock *block = ap->first;
+  while (block != NULL) {
+    ArenaBlock *next = block->next;
+    free(block);
+    block = next;
+  }
+  *ap = newArena();
+}
+
+// Makes ap the arena used by newTreeNode in this thread, NULL switches back to malloc per node
+void useArena(NodeArena *ap) {
+  activeArena = ap;
+}
+
+// Returns the arena used by newTreeNode
+NodeArena *currentArena() {
+  return activeArena;
+}
+
+// Creates a tree node, in the active arena if there is one
+ExpTree newTreeNode(TokenType tt, Token t, ExpTree tL, ExpTree tR) {
+  INSTR_COUNT(nodeAllocs);
+  chargeBudget(1, sizeof(ExpTreeNode));
+  if (activeArena != NULL) {
+    return arenaNode(activeArena, tt, t, tL, tR);
+  }
+  nodeMallocs++;
+  return newExpTreeNode(tt, t, tL, tR);
+}
+
+// Releases a single node, nodes of an arena are only released by resetArena
+void releaseNode(ExpTree tr) {
+  if (activeArena == NULL) {
+    INSTR_COUNT(nodeFrees);
+    free(tr);
+  }
+}
+
+// Releases a whole tree, nodes of an arena are only released by resetArena.
+// The nodes still to be freed are kept on a stack, so trees of any depth can be released
+void releaseExpTree(ExpTree tr) {
+  if (activeArena != NULL || tr == NULL) {
+    return;
+  }
+  Stack st = newStack(20);
+  push(&st, tr);
+  while (!isEmptyStack(st)) {
+    ExpTree node = pop(&st);
+    if (node->left != NULL) {
+      push(&st, node->left);
+    }
+    if (node->right != NULL) {
+      push(&st, node->right);
+    }
+    INSTR_COUNT(nodeFrees);
+    free(node);
+  }
+  freeStack(st);
+}
+
+// Returns the number of nodes this thread malloc'ed one by one
+long nodeMallocCount() {
+  return nodeMallocs;
+}
+
+// Prints the number of blocks malloc'ed for arenas and of nodes malloc'ed one by one. With an
+// arena active for every expression the second number stays 0
+void printArenaStats(FILE *fp, long blockMallocs, long nodeMallocs) {
+  fprintf(fp, "node allocations: %ld blocks of %d nodes, %ld nodes malloc'ed one by one\n",
+          blockMallocs, ARENA_BLOCK_NODES, nodeMallocs);
+}
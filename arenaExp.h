@@ -0,0 +1,36 @@
+#ifndef ARENAEXP_H
+#define ARENAEXP_H
+
+#include <stdio.h>
+#include "scanner.h"
+#include "prefixExp.h"
+
+// Number of tree nodes carved out of a single malloc'ed block
+#define ARENA_BLOCK_NODES 1024
+
+typedef struct ArenaBlock {
+  struct ArenaBlock *next;
+  int used;
+  ExpTreeNode nodes[ARENA_BLOCK_NODES];
+} ArenaBlock;
+
+typedef struct NodeArena {
+  ArenaBlock *first;
+  ArenaBlock *current;
+  long nodeCount;
+  long blockMallocs;
+} NodeArena;
+
+NodeArena newArena();
+ExpTree arenaNode(NodeArena *ap, TokenType tt, Token t, ExpTree tL, ExpTree tR);
+void resetArena(NodeArena *ap);
+void freeArena(NodeArena *ap);
+void useArena(NodeArena *ap);
+NodeArena *currentArena();
+ExpTree newTreeNode(TokenType tt, Token t, ExpTree tL, ExpTree tR);
+void releaseNode(ExpTree tr);
+void releaseExpTree(ExpTree tr);
+long nodeMallocCount();
+void printArenaStats(FILE *fp, long blockMallocs, long nodeMallocs);
+
+#endif
@@ -0,0 +1,533 @@
+/* file : batchExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Non-interactive mode of infixExpTrees. Expressions are read one per line from a file or
+  stdin and for every line a single result record is written:
+    <infix> TAB <value>                          for a numerical expression
+    <infix> TAB <simplified> TAB <derivative>    for an expression with identifiers
+    <infix> TAB <simplified> {TAB <identifier> TAB <partial derivative>}
+                                                 for an expression with identifiers in gradient mode
+    <infix> TAB <simplified> {TAB <derivative>}  for an expression with identifiers and an order
+                                                 above 1, the derivatives of order 1 up to order
+    error TAB <position>                         for a line that is not an expression, with the
+                                                 index of the first wrong token
+    too large                                    for an expression that needs more nodes or
+                                                 memory than the nodeBudget or memoryBudget
+  A regular input file is memory mapped and its lines are tokenized in place (see scanExp.c).
+  The token array, tree nodes and output buffer are reused for all lines.
+  With the useDag option the expression is simplified and differentiated as a hash-consed DAG
+  (see dagExp.c), which gives the same records without copying shared subtrees. With a
+  cacheCapacity above 0 derivatives of recurring subexpressions are taken from a derivative
+  cache (see derivCache.c). The derivative is taken to the variable option, "x" by default. With
+  the cse option the derivative is printed with its common subexpressions bound to temporaries
+  (see cseExp.c). With a resultCapacity above 0 the records of recurring expressions are taken
+  from a result cache keyed on their text (see resultCache.c). With the canonical option
+  simplified trees and derivatives are brought into their canonical polynomial or rational form
+  when that is smaller (see polyExp.c). With bindings every expression is first specialized for
+  the bound identifier values, its record is that of the residual expression (see
+  specializeExp.c). With a nodeBudget or memoryBudget above 0 an expression passing it is
+  aborted, everything it allocated is released and the batch goes on (see budgetExp.c).
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <math.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "scanExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "dagExp.h"
+#include "derivCache.h"
+#include "resultCache.h"
+#include "rewriteExp.h"
+#include "bytecodeExp.h"
+#include "cseExp.h"
+#include "polyExp.h"
+#include "specializeExp.h"
+#include "budgetExp.h"
+#include "batchExp.h"
+#include "instrumentExp.h"
+
+// Creates an empty output buffer of size s
+OutBuffer newOutBuffer(int s) {
+  OutBuffer b;
+  b.data = malloc(s);
+  assert(b.data != NULL);
+  b.len = 0;
+  b.size = s;
+  return b;
+}
+
+// Makes room for at least n more characters
+static void reserveOut(OutBuffer *bp, int n) {
+  if (bp->len + n <= bp->size) {
+    return;
+  }
+  while (bp->len + n > bp->size) {
+    bp->size = 2 * bp->size;
+  }
+  bp->data = realloc(bp->data, bp->size);
+  assert(bp->data != NULL);
+}
+
+// Appends n characters of s
+void appendChars(OutBuffer *bp, const char *s, int n) {
+  reserveOut(bp, n);
+  memcpy(bp->data + bp->len, s, n);
+  bp->len += n;
+}
+
+// Appends a string
+void appendString(OutBuffer *bp, const char *s) {
+  appendChars(bp, s, strlen(s));
+}
+
+// Appends a single character
+void appendChar(OutBuffer *bp, char c) {
+  reserveOut(bp, 1);
+  bp->data[bp->len] = c;
+  bp->len++;
+}
+
+// Appends a number in the same format printExpTreeInfix uses
+void appendNumber(OutBuffer *bp, double w) {
+  reserveOut(bp, 32);
+  bp->len += snprintf(bp->data + bp->len, 32, "%g", w);
+}
+
+// Appends the number of a tree node. The grammar has no negative numbers, so a negative one made
+// by folding constants is written as (0 - c), and a whole number is written with all its digits
+// instead of the rounded %g form, so both are read back as the same value
+void appendLiteral(OutBuffer *bp, double w) {
+  if (signbit(w)) {
+    appendString(bp, "(0 - ");
+    appendLiteral(bp, -w);
+    appendChar(bp, ')');
+  } else if (w == floor(w) && w < 9007199254740992.0) {
+    reserveOut(bp, 32);
+    bp->len += snprintf(bp->data + bp->len, 32, "%.0f", w);
+  } else {
+    appendNumber(bp, w);
+  }
+}
+
+// A node of the tree being printed and how much of it is printed already
+typedef struct PrintStep {
+  ExpTree tr;
+  int stage;
+} PrintStep;
+
+// Appends the infix form of the tree, in the same format as printExpTreeInfix apart from the
+// negative numbers (see appendLiteral).
+// The nodes being printed are kept on a stack, so trees of any depth can be printed
+void appendExpTreeInfix(OutBuffer *bp, ExpTree tr) {
+  INSTR_BEGIN(StagePrint);
+  PrintStep local[64];
+  PrintStep *steps = local;
+  int size = 64, top = 0;
+  steps[top].tr = tr;
+  steps[top].stage = 0;
+  top++;
+  while (top > 0) {
+    PrintStep *sp = &steps[top - 1];
+    ExpTree node = sp->tr;
+    ExpTree next = NULL;
+    switch (node->tt) {
+      case Number:
+        appendLiteral(bp, node->t.number);
+        top--;
+        break;
+      case Identifier:
+        appendString(bp, node->t.identifier);
+        top--;
+        break;
+      case Symbol:
+        //Stage 0 prints the left operand, stage 1 the operator and the right operand, stage 2 closes
+        if (sp->stage == 0) {
+          appendChar(bp, '(');
+          next = node->left;
+        } else if (sp->stage == 1) {
+          appendChar(bp, ' ');
+          appendChar(bp, node->t.symbol);
+          appendChar(bp, ' ');
+          next = node->right;
+        } else {
+          appendChar(bp, ')');
+          top--;
+        }
+        sp->stage++;
+        break;
+    }
+    if (next != NULL) {
+      if (top == size) {
+        size = 2 * size;
+        if (steps == local) {
+          steps = malloc(size * sizeof(PrintStep));
+          assert(steps != NULL);
+          memcpy(steps, local, sizeof(local));
+        } else {
+          steps = realloc(steps, size * sizeof(PrintStep));
+          assert(steps != NULL);
+        }
+      }
+      steps[top].tr = next;
+      steps[top].stage = 0;
+      top++;
+    }
+  }
+  if (steps != local) {
+    free(steps);
+  }
+  INSTR_END(StagePrint);
+}
+
+// Writes the infix form of the tree to fp, in the format of appendExpTreeInfix
+void writeExpTreeInfix(FILE *fp, ExpTree tr) {
+  OutBuffer b = newOutBuffer(256);
+  appendExpTreeInfix(&b, tr);
+  flushOutBuffer(&b, fp);
+  freeOutBuffer(&b);
+}
+
+// Writes the buffered characters to fp and empties the buffer
+void flushOutBuffer(OutBuffer *bp, FILE *fp) {
+  if (bp->len > 0) {
+    fwrite(bp->data, 1, bp->len, fp);
+  }
+  bp->len = 0;
+}
+
+// Frees up the allocated space
+void freeOutBuffer(OutBuffer *bp) {
+  free(bp->data);
+  bp->data = NULL;
+  bp->len = 0;
+  bp->size = 0;
+}
+
+// Returns the options of a plain single threaded batch
+BatchOptions defaultBatchOptions() {
+  BatchOptions o;
+  o.workers = 1;
+  o.useDag = 0;
+  o.cacheCapacity = 0;
+  o.resultCapacity = 0;
+  o.ruleStats = 0;
+  o.variable = "x";
+  o.gradient = 0;
+  o.cse = 0;
+  o.order = 1;
+  o.canonical = 0;
+  o.bindings = NULL;
+  o.bindingCount = 0;
+  o.nodeBudget = 0;
+  o.memoryBudget = 0;
+  return o;
+}
+
+// Creates the buffers shared by all expressions of a batch
+BatchContext newBatchContext(BatchOptions *op) {
+  BatchContext c;
+  c.options = *op;
+  c.dag = newDagStore();
+  c.cache = newDerivCache(op->cacheCapacity);
+  c.results = newResultCache(op->resultCapacity);
+  c.program = newProgram();
+  c.scanner = newScanner();
+  c.variable = internName(&c.scanner.names, op->variable, strlen(op->variable));
+  c.partials = NULL;
+  c.partialsSize = 0;
+  c.cse = malloc(sizeof(CseResult));
+  assert(c.cse != NULL);
+  *c.cse = newCseResult();
+  c.arena = newArena();
+  c.budget = newNodeBudget(op->nodeBudget, op->memoryBudget);
+  c.out = newOutBuffer(2 * OUT_FLUSH);
+  return c;
+}
+
+// Makes room for n trees in cp->partials
+static void growPartials(BatchContext *cp, int n) {
+  if (n > cp->partialsSize) {
+    cp->partialsSize = n;
+    cp->partials = realloc(cp->partials, n * sizeof(ExpTree));
+    assert(cp->partials != NULL);
+  }
+}
+
+// With the canonical option a DAG node is replaced by the DAG of its canonical polynomial or
+// rational form
+static ExpTree canonicalDag(BatchContext *cp, ExpTree d) {
+  return cp->options.canonical ? dagFromTree(&cp->dag, canonicalExpTree(d)) : d;
+}
+
+// Appends the simplified tree and its partial derivatives to all its identifiers, in the order
+// of their slots in the program of t. All partial derivatives come from one traversal of the DAG
+static void appendGradient(BatchContext *cp, ExpTree t) {
+  compileInto(&cp->program, t);
+  int nVars = cp->program.nameCount;
+  growPartials(cp, nVars);
+  ExpTree d = canonicalDag(cp, simplifyDag(&cp->dag, dagFromTree(&cp->dag, t)));
+  appendExpTreeInfix(&cp->out, d);
+  gradientDag(&cp->dag, d, cp->program.names, nVars, cp->partials);
+  for (int k = 0; k < nVars; k++) {
+    appendChar(&cp->out, '\t');
+    appendString(&cp->out, cp->program.names[k]);
+    appendChar(&cp->out, '\t');
+    appendExpTreeInfix(&cp->out, canonicalDag(cp, cp->partials[k]));
+  }
+  resetDagStore(&cp->dag);
+}
+
+// Appends a derivative, with the cse option its common subexpressions are bound to temporaries
+// first. inDag tells if d is a node of cp->dag
+static void appendDerivative(BatchContext *cp, ExpTree d, int inDag) {
+  if (!cp->options.cse) {
+    appendExpTreeInfix(&cp->out, d);
+  } else if (inDag) {
+    cseDag(cp->cse, &cp->dag, d);
+    appendCseInfix(&cp->out, cp->cse);
+  } else {
+    cseExpTree(cp->cse, &cp->dag, d);
+    appendCseInfix(&cp->out, cp->cse);
+    resetDagStore(&cp->dag);
+  }
+}
+
+// Appends the simplified tree and its derivatives of order 1 up to the order option, every order
+// is differentiated from the DAG of the order before it
+static void appendHigherOrders(BatchContext *cp, ExpTree t) {
+  int n = cp->options.order;
+  growPartials(cp, n + 1);
+  ExpTree d = canonicalDag(cp, simplifyDag(&cp->dag, dagFromTree(&cp->dag, t)));
+  appendExpTreeInfix(&cp->out, d);
+  higherDerivativesDag(&cp->dag, d, cp->variable, n, cp->partials);
+  for (int k = 1; k <= n; k++) {
+    appendChar(&cp->out, '\t');
+    appendDerivative(cp, canonicalDag(cp, cp->partials[k]), 1);
+  }
+  resetDagStore(&cp->dag);
+}
+
+// Checks if any of the n tokens is an identifier
+static int hasIdentifierToken(ScanToken *tokens, int n) {
+  for (int i = 0; i < n; i++) {
+    if (tokens[i].tt == Identifier) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Checks if the tree has an identifier
+static int hasIdentifier(ExpTree tr) {
+  int found = 0;
+  Stack st = newStack(20);
+  push(&st, tr);
+  while (!isEmptyStack(st) && !found) {
+    ExpTree node = pop(&st);
+    found = node->tt == Identifier;
+    if (node->tt == Symbol) {
+      push(&st, node->left);
+      push(&st, node->right);
+    }
+  }
+  //The nodes left on the stack belong to the tree
+  st.top = 0;
+  freeStack(st);
+  return found;
+}
+
+// Parses the n tokens of the scanner and appends the record of the expression, without the
+// newline
+static void appendRecord(BatchContext *cp, int n) {
+  int differingVariable = 1;
+  int errorPos = 0;
+  ExpTree t = NULL;
+  if (parseTokenArray(cp->scanner.tokens, n, &t, &errorPos)) {
+    INSTR_TREE_SIZE(t);
+    appendExpTreeInfix(&cp->out, t);
+    appendChar(&cp->out, '\t');
+    //A numerical expression is known from its tokens, only one with bindings has to be checked
+    //again after the bound identifiers are replaced by their values
+    int numerical = !hasIdentifierToken(cp->scanner.tokens, n);
+    if (cp->options.bindingCount > 0) {
+      t = specializeExpTree(t, cp->options.bindings, cp->options.bindingCount);
+      numerical = numerical || !hasIdentifier(t);
+    }
+    if (numerical) {
+      //The program gives the value valueExpTree would give, a division by zero gives inf or nan
+      //instead of aborting the batch
+      compileInto(&cp->program, t);
+      appendNumber(&cp->out, runProgram(&cp->program, NULL));
+    } else if (cp->options.gradient) {
+      appendGradient(cp, t);
+    } else if (cp->options.order > 1) {
+      appendHigherOrders(cp, t);
+    } else {
+      if (cp->options.useDag) {
+        ExpTree d = canonicalDag(cp, simplifyDag(&cp->dag, dagFromTree(&cp->dag, t)));
+        appendExpTreeInfix(&cp->out, d);
+        appendChar(&cp->out, '\t');
+        appendDerivative(cp, canonicalDag(cp, differentiateDag(&cp->dag, d, cp->variable)), 1);
+        resetDagStore(&cp->dag);
+      } else {
+        t = simplify(t);
+        if (cp->options.canonical) {
+          t = canonicalExpTree(t);
+        }
+        appendExpTreeInfix(&cp->out, t);
+        appendChar(&cp->out, '\t');
+        if (cp->options.cacheCapacity > 0) {
+          t = derivativeCached(&cp->cache, t, cp->variable);
+        } else {
+          differentiateTo(&t, cp->variable, &differingVariable);
+          t = simplify(t);
+        }
+        if (cp->options.canonical) {
+          t = canonicalExpTree(t);
+        }
+        INSTR_TREE_SIZE(t);
+        appendDerivative(cp, t, 0);
+      }
+    }
+  } else {
+    appendString(&cp->out, "error\t");
+    appendNumber(&cp->out, errorPos);
+  }
+}
+
+// Handles the expression in the length characters of line and appends its result record to
+// the output buffer
+void processExpression(BatchContext *cp, const char *line, int length) {
+  if (cp->options.resultCapacity > 0) {
+    ResultEntry *e = findResult(&cp->results, line, length);
+    if (e != NULL) {
+      appendChars(&cp->out, e->text + e->keyLength, e->recordLength);
+      appendChar(&cp->out, '\n');
+      return;
+    }
+  }
+  int mark = cp->out.len;
+  int n = scanTokens(&cp->scanner, line, length);
+  NodeArena *previous = currentArena();
+  useArena(&cp->arena);
+  if (!isBudgetLimited(&cp->budget)) {
+    appendRecord(cp, n);
+  } else {
+    //When the budget is exceeded the part of the record appended so far is dropped. The budget
+    //has freed the scratch arrays, the nodes are released with the arena and the DAG store
+    if (setjmp(cp->budget.exceeded) == 0) {
+      startBudget(&cp->budget);
+      appendRecord(cp, n);
+      stopBudget();
+    } else {
+      cp->out.len = mark;
+      appendString(&cp->out, "too large");
+      resetDagStore(&cp->dag);
+    }
+  }
+  if (cp->options.resultCapacity > 0) {
+    storeResult(&cp->results, cp->out.data + mark, cp->out.len - mark);
+  }
+  appendChar(&cp->out, '\n');
+  //All nodes of the expression are released at once
+  resetArena(&cp->arena);
+  useArena(previous);
+}
+
+// Frees up the allocated space
+void freeBatchContext(BatchContext *cp) {
+  freeScanner(&cp->scanner);
+  free(cp->partials);
+  freeCseResult(cp->cse);
+  free(cp->cse);
+  freeArena(&cp->arena);
+  freeDagStore(&cp->dag);
+  freeDerivCache(&cp->cache);
+  freeResultCache(&cp->results);
+  freeProgram(&cp->program);
+  freeOutBuffer(&cp->out);
+}
+
+// Reads a line from fp into the buffer *bufp of size *sizep, which grows when needed.
+// The line end is removed. Returns 0 at the end of the input
+int readLine(FILE *fp, char **bufp, int *sizep) {
+  int len = 0;
+  if (*bufp == NULL) {
+    *sizep = MAXINPUT;
+    *bufp = malloc(*sizep);
+    assert(*bufp != NULL);
+  }
+  while (fgets(*bufp + len, *sizep - len, fp) != NULL) {
+    len += strlen(*bufp + len);
+    if (len > 0 && (*bufp)[len - 1] == '\n') {
+      break;
+    }
+    //The line did not fit, the buffer is doubled and the rest of the line is read
+    *sizep = 2 * *sizep;
+    *bufp = realloc(*bufp, *sizep);
+    assert(*bufp != NULL);
+  }
+  if (len == 0) {
+    return 0;
+  }
+  while (len > 0 && ((*bufp)[len - 1] == '\n' || (*bufp)[len - 1] == '\r')) {
+    len--;
+  }
+  (*bufp)[len] = '\0';
+  return 1;
+}
+
+// Processes all expressions of in and writes one result record per line to out.
+// The input ends at end of file or at a line starting with '!'. A regular file is mapped into
+// memory and scanned in place, other input is read line by line
+void infixExpBatch(FILE *in, FILE *out, BatchOptions *op) {
+  char *line = NULL;
+  int size = 0;
+  BatchContext context = newBatchContext(op);
+  MappedInput map;
+  if (mapInput(in, &map)) {
+    const char *text;
+    int length;
+    while (nextMappedLine(&map, &text, &length) && !(length > 0 && text[0] == '!')) {
+      processExpression(&context, text, length);
+      if (context.out.len >= OUT_FLUSH) {
+        flushOutBuffer(&context.out, out);
+      }
+    }
+    unmapInput(&map);
+  } else {
+    while (readLine(in, &line, &size) && line[0] != '!') {
+      processExpression(&context, line, strlen(line));
+      if (context.out.len >= OUT_FLUSH) {
+        flushOutBuffer(&context.out, out);
+      }
+    }
+  }
+  flushOutBuffer(&context.out, out);
+  fflush(out);
+  if (op->cacheCapacity > 0) {
+    printCacheStats(stderr, &context.cache);
+  }
+  if (op->resultCapacity > 0) {
+    printResultStats(stderr, &context.results);
+  }
+  if (op->cse) {
+    printCseStats(stderr, context.cse);
+  }
+  if (op->ruleStats) {
+    mergeRewriteStats();
+    printRewriteStats(stderr);
+    printArenaStats(stderr, context.arena.blockMallocs, nodeMallocCount());
+  }
+  freeBatchContext(&context);
+  freeSpareStacks();
+  free(line);
+}
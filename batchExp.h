@@ -0,0 +1,77 @@
+#ifndef BATCHEXP_H
+#define BATCHEXP_H
+
+#include <stdio.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "scanExp.h"
+#include "arenaExp.h"
+#include "dagExp.h"
+#include "derivCache.h"
+#include "resultCache.h"
+#include "bytecodeExp.h"
+#include "budgetExp.h"
+#include "specializeExp.h"
+
+// The output buffer is written out once it holds this many characters
+#define OUT_FLUSH (1 << 20)
+
+typedef struct OutBuffer {
+  char *data;
+  int len;
+  int size;
+} OutBuffer;
+
+struct CseResult;
+
+typedef struct BatchOptions {
+  int workers;
+  int useDag;
+  int cacheCapacity;
+  int resultCapacity;
+  int ruleStats;
+  char *variable;
+  int gradient;
+  int cse;
+  int order;
+  int canonical;
+  Binding *bindings;
+  int bindingCount;
+  long nodeBudget;
+  long memoryBudget;
+} BatchOptions;
+
+typedef struct BatchContext {
+  BatchOptions options;
+  Scanner scanner;
+  char *variable;
+  ExpTree *partials;
+  int partialsSize;
+  struct CseResult *cse;
+  NodeArena arena;
+  NodeBudget budget;
+  DagStore dag;
+  DerivCache cache;
+  ResultCache results;
+  Program program;
+  OutBuffer out;
+} BatchContext;
+
+OutBuffer newOutBuffer(int s);
+void appendChars(OutBuffer *bp, const char *s, int n);
+void appendString(OutBuffer *bp, const char *s);
+void appendChar(OutBuffer *bp, char c);
+void appendNumber(OutBuffer *bp, double w);
+void appendLiteral(OutBuffer *bp, double w);
+void appendExpTreeInfix(OutBuffer *bp, ExpTree tr);
+void writeExpTreeInfix(FILE *fp, ExpTree tr);
+void flushOutBuffer(OutBuffer *bp, FILE *fp);
+void freeOutBuffer(OutBuffer *bp);
+BatchOptions defaultBatchOptions();
+BatchContext newBatchContext(BatchOptions *op);
+void processExpression(BatchContext *cp, const char *line, int length);
+void freeBatchContext(BatchContext *cp);
+int readLine(FILE *fp, char **bufp, int *sizep);
+void infixExpBatch(FILE *in, FILE *out, BatchOptions *op);
+
+#endif
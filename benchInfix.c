@@ -0,0 +1,1139 @@
+/* file : benchInfix.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Benchmarks of the expression pipeline on random expressions. A seeded generator makes count
+  expressions of about size nodes, at most depth levels deep, with the operators mixed in the
+  ratio of the -m weights and identifiers taken from a pool of -i names (x is always one of them).
+  Every stage is timed separately, the fastest of -t runs is reported. A record is one JSON
+  object per line:
+    {"bench": <stage>, "seed": .., "count": .., "size": .., "depth": .., "identifiers": ..,
+     "mix": "+,-,*,/", "ops": .., "ns_per_op": .., "nodes_per_sec": .., "peak_rss_kb": ..}
+  ns_per_op is per expression (per row or per point for the evaluation stages), nodes_per_sec
+  counts the nodes of the input trees and peak_rss_kb is the peak memory of the process so far.
+  The hash_pointer and hash_flat stages, which walk the same trees as linked nodes and as flat
+  arrays, also write a record
+    {"bench": <stage>_misses, "seed": .., "count": .., "cache_misses": .., "misses_per_node": ..}
+  with the cache misses of the fastest run as counted by perf_event_open, -1 where the system
+  does not allow that.
+  The program is built from all sources except mainInfix.c and testInfix.c, for instance
+    gcc -O2 -o benchInfix benchInfix.c <the other .c files> -lpthread -lm
+
+  usage: benchInfix [-n count] [-s size] [-d depth] [-m w+,w-,w*,w/] [-i identifiers] [-r seed]
+                    [-t runs] [-j workers] [-D deepDepth] [-o file]
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <math.h>
+#include <setjmp.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "scanner.h"
+#include "recognizeExp.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "scanExp.h"
+#include "symbolTable.h"
+#include "dagExp.h"
+#include "derivCache.h"
+#include "bytecodeExp.h"
+#include "jitExp.h"
+#include "specializeExp.h"
+#include "libraryExp.h"
+#include "vectorExp.h"
+#include "adjointExp.h"
+#include "flatExp.h"
+#include "cseExp.h"
+#include "budgetExp.h"
+#include "batchExp.h"
+#include "parallelExp.h"
+
+// Number of rows of the evaluation benchmarks and number of points of the gradient benchmarks
+#define BENCH_ROWS 4096
+#define BENCH_POINTS 16
+// Number of expressions the row and point benchmarks use
+#define BENCH_FORMULAS 64
+// Highest order of the higher order derivative benchmark, the tree path gives up on an
+// expression that needs more than BENCH_ORDER_NODES nodes
+#define BENCH_ORDER 10
+#define BENCH_ORDER_NODES (1L << 22)
+// Capacity of the result cache in the benchmark of a skewed batch
+#define BENCH_RESULTS 256
+
+typedef struct BenchConfig {
+  int count;
+  int size;
+  int depth;
+  int mix[4];
+  int identifiers;
+  unsigned long seed;
+  int runs;
+  int workers;
+  int deepDepth;
+  FILE *out;
+} BenchConfig;
+
+// The expressions of a benchmark as text, token lists and trees
+typedef struct Workload {
+  char **texts;
+  List *lists;
+  ExpTree *trees;
+  int count;
+  long nodes;
+} Workload;
+
+static const char operators[4] = {'+', '-', '*', '/'};
+static char identifierNames[64][8];
+
+// xorshift64* generator, the same seed always gives the same expressions
+static unsigned long nextRandom(unsigned long *state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 2685821657736338717UL;
+}
+
+// Returns a random number in 0 .. n-1
+static int randomBelow(unsigned long *state, int n) {
+  return (int)((nextRandom(state) >> 33) % (unsigned long)n);
+}
+
+// Appends a random expression with leaves leaves and at most depth levels
+static void generate(OutBuffer *bp, BenchConfig *cfg, unsigned long *state, int identifiers, int leaves, int depth) {
+  if (leaves <= 1 || depth <= 1) {
+    if (identifiers > 0 && randomBelow(state, 2) == 0) {
+      appendString(bp, identifierNames[randomBelow(state, identifiers)]);
+    } else {
+      appendChar(bp, '1' + randomBelow(state, 9));
+    }
+    return;
+  }
+  int total = cfg->mix[0] + cfg->mix[1] + cfg->mix[2] + cfg->mix[3];
+  int pick = randomBelow(state, total);
+  int op = 0;
+  while (pick >= cfg->mix[op]) {
+    pick -= cfg->mix[op];
+    op++;
+  }
+  int left = 1 + randomBelow(state, leaves - 1);
+  //Half of the subexpressions get parentheses, the others are grouped by precedence
+  int parens = randomBelow(state, 2);
+  if (parens) {
+    appendChar(bp, '(');
+  }
+  generate(bp, cfg, state, identifiers, left, depth - 1);
+  appendChar(bp, ' ');
+  appendChar(bp, operators[op]);
+  appendChar(bp, ' ');
+  generate(bp, cfg, state, identifiers, leaves - left, depth - 1);
+  if (parens) {
+    appendChar(bp, ')');
+  }
+}
+
+// Generates, tokenizes and parses count expressions, the trees are made in the active arena
+static Workload makeWorkload(BenchConfig *cfg, int identifiers, unsigned long seed) {
+  Workload w;
+  unsigned long state = seed == 0 ? 1 : seed;
+  OutBuffer text = newOutBuffer(1024);
+  w.texts = malloc(cfg->count * sizeof(char *));
+  w.lists = malloc(cfg->count * sizeof(List));
+  w.trees = malloc(cfg->count * sizeof(ExpTree));
+  assert(w.texts != NULL && w.lists != NULL && w.trees != NULL);
+  w.count = 0;
+  w.nodes = 0;
+  for (int i = 0; i < cfg->count; i++) {
+    text.len = 0;
+    generate(&text, cfg, &state, identifiers, (cfg->size + 1) / 2, cfg->depth);
+    appendChar(&text, '\0');
+    List tl = tokenList(text.data);
+    List l = tl;
+    ExpTree t = NULL;
+    int errorPos;
+    if (!parseInfixExpr(&l, &t, &errorPos)) {
+      freeTokenList(tl);
+      continue;
+    }
+    w.texts[w.count] = strdup(text.data);
+    assert(w.texts[w.count] != NULL);
+    w.lists[w.count] = tl;
+    w.trees[w.count] = t;
+    w.nodes += sizeExpTree(t);
+    w.count++;
+  }
+  freeOutBuffer(&text);
+  return w;
+}
+
+// Frees the texts and lists of a workload, the trees belong to the arena
+static void freeWorkload(Workload *wp) {
+  for (int i = 0; i < wp->count; i++) {
+    free(wp->texts[i]);
+    freeTokenList(wp->lists[i]);
+  }
+  free(wp->texts);
+  free(wp->lists);
+  free(wp->trees);
+}
+
+// Checks if valueExpTree can evaluate the numerical tree, it asserts on a division by zero
+static int safeForValue(FlatTree *fp) {
+  double *values = malloc((fp->count + 1) * sizeof(double));
+  assert(values != NULL);
+  int safe = 1;
+  for (int i = 0; i < fp->count && safe; i++) {
+    if (fp->kind[i] == Number) {
+      values[i] = fp->payload[i].number;
+      continue;
+    }
+    double a = values[fp->left[i]], b = values[fp->right[i]];
+    switch (fp->payload[i].symbol) {
+      case '+':
+        values[i] = a + b;
+        break;
+      case '-':
+        values[i] = a - b;
+        break;
+      case '*':
+        values[i] = a * b;
+        break;
+      default:
+        safe = b != 0;
+        values[i] = a / b;
+    }
+  }
+  free(values);
+  return safe;
+}
+
+// Returns the time in nanoseconds
+static double nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Returns the peak resident memory of the process in kilobytes
+static long peakRssKb() {
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_maxrss;
+}
+
+// Opens a counter of the cache misses of this thread, returns -1 if the system does not give one
+static int openMissCounter() {
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+// Starts counting cache misses from 0
+static void startMisses(int counter) {
+#ifdef __linux__
+  if (counter >= 0) {
+    ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+    ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+// Stops counting, returns the cache misses since startMisses or -1 without a counter
+static long stopMisses(int counter) {
+#ifdef __linux__
+  long long count;
+  if (counter >= 0) {
+    ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(counter, &count, sizeof(count)) == sizeof(count)) {
+      return (long)count;
+    }
+  }
+#endif
+  return -1;
+}
+
+// Writes the record of a stage that did ops operations on nodes input nodes in ns nanoseconds
+static void report(BenchConfig *cfg, const char *bench, long ops, double nodes, double ns) {
+  if (ns <= 0) {
+    ns = 1;
+  }
+  fprintf(cfg->out,
+          "{\"bench\": \"%s\", \"seed\": %lu, \"count\": %d, \"size\": %d, \"depth\": %d, "
+          "\"identifiers\": %d, \"mix\": \"%d,%d,%d,%d\", \"ops\": %ld, \"ns_per_op\": %.1f, "
+          "\"nodes_per_sec\": %.0f, \"peak_rss_kb\": %ld}\n",
+          bench, cfg->seed, cfg->count, cfg->size, cfg->depth, cfg->identifiers,
+          cfg->mix[0], cfg->mix[1], cfg->mix[2], cfg->mix[3], ops,
+          ops == 0 ? 0.0 : ns / ops, nodes * 1e9 / ns, peakRssKb());
+  fflush(cfg->out);
+}
+
+// The stages of the benchmark. Each one does its work on all expressions of the workload and
+// returns the time that took; preparing copies of the input is not timed
+typedef enum Stage {
+  ScanList,
+  ScanArray,
+  ParseTwoPass,
+  Parse,
+  ScanParseArray,
+  Simplify,
+  SimplifySinglePass,
+  Differentiate,
+  Derivative,
+  DerivativeDag,
+  DerivativeCached,
+  Cse,
+  Print,
+  PrintBuffer,
+  HashPointer,
+  HashFlat,
+  StageCount
+} Stage;
+
+static const char *stageNames[StageCount] = {
+  "scan_list", "scan_array", "parse_two_pass", "parse", "scan_parse_array", "simplify",
+  "simplify_single_pass", "differentiate", "derivative", "derivative_dag", "derivative_cached",
+  "cse", "print", "print_buffer", "hash_pointer", "hash_flat"
+};
+
+// State shared by the stages
+typedef struct Bench {
+  Workload *wp;
+  ExpTree *simplified;
+  ExpTree *copies;
+  NodeArena work;
+  Scanner scanner;
+  DagStore dag;
+  DerivCache cache;
+  CseResult cse;
+  OutBuffer out;
+  FlatTree *flats;
+  char *x;
+  int missCounter;
+  long misses;
+} Bench;
+
+// Runs one stage once and returns its time in nanoseconds
+static double runStage(Bench *bp, Stage stage) {
+  Workload *wp = bp->wp;
+  int n = wp->count;
+  int differingVariable = 1;
+  int errorPos = 0;
+  unsigned long hashes = 0;
+  useArena(&bp->work);
+  //Stages that change their input get fresh copies
+  if (stage == Simplify || stage == SimplifySinglePass) {
+    for (int i = 0; i < n; i++) {
+      bp->copies[i] = duplicate(wp->trees[i]);
+    }
+  } else if (stage == Differentiate || stage == Derivative) {
+    for (int i = 0; i < n; i++) {
+      bp->copies[i] = duplicate(bp->simplified[i]);
+    }
+  } else if (stage == Cse) {
+    for (int i = 0; i < n; i++) {
+      bp->copies[i] = duplicate(bp->simplified[i]);
+      differentiate(&bp->copies[i], &differingVariable);
+      bp->copies[i] = simplify(bp->copies[i]);
+    }
+  }
+  int counting = stage == HashPointer || stage == HashFlat;
+  if (counting) {
+    startMisses(bp->missCounter);
+  }
+  double start = nowNs();
+  for (int i = 0; i < n; i++) {
+    List l = wp->lists[i];
+    ExpTree t = NULL;
+    switch (stage) {
+      case ScanList:
+        freeTokenList(tokenList(wp->texts[i]));
+        break;
+      case ScanArray:
+        scanTokens(&bp->scanner, wp->texts[i], strlen(wp->texts[i]));
+        break;
+      case ParseTwoPass: {
+        //The parenthesis counter of treeInfixExpr starts at 0 for every expression
+        int paranthesis = 0;
+        if (acceptExpression(&l) && l == NULL) {
+          l = wp->lists[i];
+          treeInfixExpr(&l, &t, &paranthesis);
+        }
+        break;
+      }
+      case Parse:
+        parseInfixExpr(&l, &t, &errorPos);
+        break;
+      case ScanParseArray: {
+        int k = scanTokens(&bp->scanner, wp->texts[i], strlen(wp->texts[i]));
+        parseTokenArray(bp->scanner.tokens, k, &t, &errorPos);
+        break;
+      }
+      case Simplify:
+        simplify(bp->copies[i]);
+        break;
+      case SimplifySinglePass:
+        simplifyRec(bp->copies[i]);
+        break;
+      case Differentiate:
+        differentiate(&bp->copies[i], &differingVariable);
+        break;
+      case Derivative:
+        differentiate(&bp->copies[i], &differingVariable);
+        simplify(bp->copies[i]);
+        break;
+      case DerivativeDag: {
+        ExpTree d = simplifyDag(&bp->dag, dagFromTree(&bp->dag, wp->trees[i]));
+        differentiateDag(&bp->dag, d, bp->x);
+        resetDagStore(&bp->dag);
+        break;
+      }
+      case DerivativeCached:
+        derivativeCached(&bp->cache, bp->simplified[i], bp->x);
+        break;
+      case Cse:
+        cseExpTree(&bp->cse, &bp->dag, bp->copies[i]);
+        resetDagStore(&bp->dag);
+        break;
+      case Print:
+        printExpTreeInfix(wp->trees[i]);
+        break;
+      case PrintBuffer:
+        appendExpTreeInfix(&bp->out, wp->trees[i]);
+        bp->out.len = 0;
+        break;
+      case HashPointer:
+        hashes += hashExpTree(wp->trees[i]);
+        break;
+      case HashFlat:
+        hashes += hashFlatTree(&bp->flats[i]);
+        break;
+      default:
+        break;
+    }
+  }
+  double ns = nowNs() - start;
+  if (counting) {
+    bp->misses = stopMisses(bp->missCounter);
+  }
+  if (stage == Print) {
+    fflush(stdout);
+  }
+  //Keeps the hash loops from being optimized away
+  if (hashes == 1) {
+    fprintf(stderr, " ");
+  }
+  resetArena(&bp->work);
+  useArena(NULL);
+  return ns;
+}
+
+// Reports the fastest of cfg->runs runs of a stage
+static void benchStage(BenchConfig *cfg, Bench *bp, Stage stage) {
+  double best = 0;
+  long misses = -1;
+  for (int r = 0; r < cfg->runs; r++) {
+    double ns = runStage(bp, stage);
+    if (r == 0 || ns < best) {
+      best = ns;
+      misses = bp->misses;
+    }
+  }
+  report(cfg, stageNames[stage], bp->wp->count, bp->wp->nodes, best);
+  if (stage == HashPointer || stage == HashFlat) {
+    fprintf(cfg->out,
+            "{\"bench\": \"%s_misses\", \"seed\": %lu, \"count\": %d, \"cache_misses\": %ld, "
+            "\"misses_per_node\": %.3f}\n",
+            stageNames[stage], cfg->seed, cfg->count, misses,
+            misses < 0 || bp->wp->nodes == 0 ? -1.0 : (double)misses / bp->wp->nodes);
+    fflush(cfg->out);
+  }
+}
+
+// Compares valueExpTree, the compiled program, the flat tree and the machine code on numerical
+// expressions
+static void benchValues(BenchConfig *cfg, NodeArena *base) {
+  useArena(base);
+  Workload w = makeWorkload(cfg, 0, cfg->seed + 1);
+  useArena(NULL);
+  //Expressions with a division by zero are left out, valueExpTree would abort on them
+  FlatTree *flats = malloc((w.count + 1) * sizeof(FlatTree));
+  Program *programs = malloc((w.count + 1) * sizeof(Program));
+  JitCode *jits = malloc((w.count + 1) * sizeof(JitCode));
+  ExpTree *trees = malloc((w.count + 1) * sizeof(ExpTree));
+  assert(flats != NULL && programs != NULL && jits != NULL && trees != NULL);
+  int n = 0;
+  long nodes = 0;
+  for (int i = 0; i < w.count; i++) {
+    flats[n] = newFlatTree();
+    flattenExpTree(&flats[n], w.trees[i]);
+    if (!safeForValue(&flats[n])) {
+      freeFlatTree(&flats[n]);
+      continue;
+    }
+    programs[n] = compileExpTree(w.trees[i]);
+    jits[n] = compileJit(w.trees[i]);
+    trees[n] = w.trees[i];
+    nodes += flats[n].count;
+    n++;
+  }
+  const char *names[4] = {"value", "value_bytecode", "value_flat", "value_jit"};
+  for (int kind = 0; kind < 4; kind++) {
+    double best = 0, sum = 0;
+    for (int r = 0; r < cfg->runs; r++) {
+      double start = nowNs();
+      for (int i = 0; i < n; i++) {
+        if (kind == 0) {
+          sum += valueExpTree(trees[i]);
+        } else if (kind == 1) {
+          sum += runProgram(&programs[i], NULL);
+        } else if (kind == 2) {
+          sum += valueFlatTree(&flats[i], NULL);
+        } else {
+          sum += runJit(&jits[i], NULL);
+        }
+      }
+      double ns = nowNs() - start;
+      if (r == 0 || ns < best) {
+        best = ns;
+      }
+    }
+    if (sum == 0.5) {
+      fprintf(stderr, " ");
+    }
+    report(cfg, names[kind], n, nodes, best);
+  }
+  for (int i = 0; i < n; i++) {
+    freeFlatTree(&flats[i]);
+    freeProgram(&programs[i]);
+    freeJit(&jits[i]);
+  }
+  free(flats);
+  free(programs);
+  free(jits);
+  free(trees);
+  freeWorkload(&w);
+}
+
+// Compares evaluating expressions row by row with runProgram, per block with runProgramColumns
+// and row by row with the machine code of runJit
+static void benchRows(BenchConfig *cfg, Workload *wp) {
+  int n = wp->count < BENCH_FORMULAS ? wp->count : BENCH_FORMULAS;
+  long nodes = 0;
+  int maxSlots = 1;
+  Program *programs = malloc((n + 1) * sizeof(Program));
+  JitCode *jits = malloc((n + 1) * sizeof(JitCode));
+  assert(programs != NULL && jits != NULL);
+  for (int i = 0; i < n; i++) {
+    programs[i] = compileExpTree(wp->trees[i]);
+    jits[i] = compileJit(wp->trees[i]);
+    nodes += sizeExpTree(wp->trees[i]);
+    if (programs[i].nameCount > maxSlots) {
+      maxSlots = programs[i].nameCount;
+    }
+  }
+  double **columns = malloc(maxSlots * sizeof(double *));
+  double *out = malloc(BENCH_ROWS * sizeof(double));
+  double *vars = malloc(maxSlots * sizeof(double));
+  assert(columns != NULL && out != NULL && vars != NULL);
+  for (int j = 0; j < maxSlots; j++) {
+    columns[j] = malloc(BENCH_ROWS * sizeof(double));
+    assert(columns[j] != NULL);
+    for (int r = 0; r < BENCH_ROWS; r++) {
+      columns[j][r] = 1 + 0.001 * r + j;
+    }
+  }
+  const char *names[3] = {"eval_rows_scalar", "eval_rows_vector", "eval_rows_jit"};
+  for (int kind = 0; kind < 3; kind++) {
+    double best = 0, sum = 0;
+    for (int run = 0; run < cfg->runs; run++) {
+      double start = nowNs();
+      for (int i = 0; i < n; i++) {
+        if (kind == 1) {
+          runProgramColumns(&programs[i], (const double **)columns, BENCH_ROWS, out);
+          sum += out[0];
+        } else {
+          for (int r = 0; r < BENCH_ROWS; r++) {
+            for (int j = 0; j < programs[i].nameCount; j++) {
+              vars[j] = columns[j][r];
+            }
+            sum += kind == 0 ? runProgram(&programs[i], vars) : runJit(&jits[i], vars);
+          }
+        }
+      }
+      double ns = nowNs() - start;
+      if (run == 0 || ns < best) {
+        best = ns;
+      }
+    }
+    if (sum == 0.5) {
+      fprintf(stderr, " ");
+    }
+    report(cfg, names[kind], (long)n * BENCH_ROWS, (double)nodes * BENCH_ROWS, best);
+  }
+  for (int j = 0; j < maxSlots; j++) {
+    free(columns[j]);
+  }
+  for (int i = 0; i < n; i++) {
+    freeProgram(&programs[i]);
+    freeJit(&jits[i]);
+  }
+  free(columns);
+  free(out);
+  free(vars);
+  free(programs);
+  free(jits);
+}
+
+// Compares evaluating expressions row by row with all identifiers but x fixed, compiled as they
+// are and compiled after specializing them for the fixed values
+static void benchSpecialize(BenchConfig *cfg, Workload *wp, NodeArena *work) {
+  int n = wp->count < BENCH_FORMULAS ? wp->count : BENCH_FORMULAS;
+  long nodes = 0;
+  char *x = internIdentifier("x", 1);
+  JitCode *general = malloc((n + 1) * sizeof(JitCode));
+  JitCode *specialized = malloc((n + 1) * sizeof(JitCode));
+  assert(general != NULL && specialized != NULL);
+  Binding bindings[64];
+  double fixed[64];
+  useArena(work);
+  for (int i = 0; i < n; i++) {
+    general[i] = compileJit(wp->trees[i]);
+    nodes += sizeExpTree(wp->trees[i]);
+    int nBound = 0;
+    for (int k = 0; k < general[i].program.nameCount && nBound < 64; k++) {
+      if (general[i].program.names[k] != x) {
+        bindings[nBound].name = general[i].program.names[k];
+        bindings[nBound].value = 1 + k;
+        nBound++;
+      }
+    }
+    specialized[i] = compileJit(specializeExpTree(wp->trees[i], bindings, nBound));
+    resetArena(work);
+  }
+  useArena(NULL);
+  for (int k = 0; k < 64; k++) {
+    fixed[k] = 1 + k;
+  }
+  for (int kind = 0; kind < 2; kind++) {
+    double best = 0, sum = 0;
+    for (int run = 0; run < cfg->runs; run++) {
+      double start = nowNs();
+      for (int i = 0; i < n; i++) {
+        JitCode *jp = kind ? &specialized[i] : &general[i];
+        int slot = programSlot(&jp->program, x);
+        if (jp->program.nameCount > 64) {
+          continue;
+        }
+        for (int r = 0; r < BENCH_ROWS; r++) {
+          if (slot >= 0) {
+            fixed[slot] = 1 + 0.001 * r;
+          }
+          sum += runJit(jp, fixed);
+        }
+        if (slot >= 0) {
+          fixed[slot] = 1 + slot;
+        }
+      }
+      double ns = nowNs() - start;
+      if (run == 0 || ns < best) {
+        best = ns;
+      }
+    }
+    if (sum == 0.5) {
+      fprintf(stderr, " ");
+    }
+    report(cfg, kind ? "eval_specialized" : "eval_general", (long)n * BENCH_ROWS, (double)nodes * BENCH_ROWS, best);
+  }
+  for (int i = 0; i < n; i++) {
+    freeJit(&general[i]);
+    freeJit(&specialized[i]);
+  }
+  free(general);
+  free(specialized);
+}
+
+// Compares the gradient from the reverse mode tape with evaluating a symbolic derivative per variable
+static void benchGradients(BenchConfig *cfg, Workload *wp, NodeArena *work) {
+  int n = wp->count < BENCH_FORMULAS ? wp->count : BENCH_FORMULAS;
+  long nodes = 0;
+  Program *programs = malloc((n + 1) * sizeof(Program));
+  Tape *tapes = malloc((n + 1) * sizeof(Tape));
+  Program **partials = malloc((n + 1) * sizeof(Program *));
+  int **slotMaps = malloc((n + 1) * sizeof(int *));
+  assert(programs != NULL && tapes != NULL && partials != NULL && slotMaps != NULL);
+  useArena(work);
+  for (int i = 0; i < n; i++) {
+    programs[i] = compileExpTree(wp->trees[i]);
+    tapes[i] = newTape(&programs[i]);
+    nodes += sizeExpTree(wp->trees[i]);
+    int nVars = programs[i].nameCount;
+    partials[i] = malloc((nVars + 1) * sizeof(Program));
+    slotMaps[i] = malloc((nVars * nVars + 1) * sizeof(int));
+    assert(partials[i] != NULL && slotMaps[i] != NULL);
+    for (int k = 0; k < nVars; k++) {
+      int differingVariable = 1;
+      ExpTree d = duplicate(wp->trees[i]);
+      differentiateTo(&d, programs[i].names[k], &differingVariable);
+      partials[i][k] = compileExpTree(simplify(d));
+      for (int j = 0; j < partials[i][k].nameCount; j++) {
+        slotMaps[i][k * nVars + j] = programSlot(&programs[i], partials[i][k].names[j]);
+      }
+    }
+  }
+  resetArena(work);
+  useArena(NULL);
+  double vars[64], grad[64], sub[64];
+  for (int reverse = 0; reverse < 2; reverse++) {
+    double best = 0, sum = 0;
+    for (int run = 0; run < cfg->runs; run++) {
+      double start = nowNs();
+      for (int i = 0; i < n; i++) {
+        int nVars = programs[i].nameCount;
+        if (nVars > 64) {
+          continue;
+        }
+        for (int p = 0; p < BENCH_POINTS; p++) {
+          for (int k = 0; k < nVars; k++) {
+            vars[k] = 1 + 0.25 * p + k;
+          }
+          if (reverse) {
+            sum += gradientProgram(&tapes[i], vars, grad);
+          } else {
+            sum += runProgram(&programs[i], vars);
+            for (int k = 0; k < nVars; k++) {
+              for (int j = 0; j < partials[i][k].nameCount; j++) {
+                sub[j] = vars[slotMaps[i][k * nVars + j]];
+              }
+              grad[k] = runProgram(&partials[i][k], sub);
+            }
+          }
+          sum += grad[0];
+        }
+      }
+      double ns = nowNs() - start;
+      if (run == 0 || ns < best) {
+        best = ns;
+      }
+    }
+    if (sum == 0.5) {
+      fprintf(stderr, " ");
+    }
+    report(cfg, reverse ? "gradient_reverse" : "gradient_symbolic", (long)n * BENCH_POINTS,
+           (double)nodes * BENCH_POINTS, best);
+  }
+  for (int i = 0; i < n; i++) {
+    for (int k = 0; k < programs[i].nameCount; k++) {
+      freeProgram(&partials[i][k]);
+    }
+    free(partials[i]);
+    free(slotMaps[i]);
+    freeTape(&tapes[i]);
+    freeProgram(&programs[i]);
+  }
+  free(partials);
+  free(slotMaps);
+  free(tapes);
+  free(programs);
+}
+
+// Times getting the derivatives up to order n of all trees by differentiating and simplifying
+// n times over, as infixExpTrees would do. Returns -1 when an expression passes the budget
+static double timeTreeOrders(Workload *wp, int n, NodeArena *work, NodeBudget *bp, char *x) {
+  useArena(work);
+  if (setjmp(bp->exceeded) != 0) {
+    resetArena(work);
+    useArena(NULL);
+    return -1;
+  }
+  double start = nowNs();
+  for (int i = 0; i < wp->count; i++) {
+    int differingVariable = 1;
+    startBudget(bp);
+    ExpTree t = simplify(duplicate(wp->trees[i]));
+    for (int k = 0; k < n; k++) {
+      differentiateTo(&t, x, &differingVariable);
+      t = simplify(t);
+    }
+    stopBudget();
+    resetArena(work);
+  }
+  double ns = nowNs() - start;
+  useArena(NULL);
+  return ns;
+}
+
+// Times getting the derivatives up to order n of all trees with higherDerivativesDag
+static double timeDagOrders(Workload *wp, int n, DagStore *sp, char *x) {
+  ExpTree out[BENCH_ORDER + 1];
+  double start = nowNs();
+  for (int i = 0; i < wp->count; i++) {
+    ExpTree d = simplifyDag(sp, dagFromTree(sp, wp->trees[i]));
+    higherDerivativesDag(sp, d, x, n, out);
+    resetDagStore(sp);
+  }
+  return nowNs() - start;
+}
+
+// Compares the derivatives up to order 1 .. BENCH_ORDER by repeated differentiate and simplify
+// with higherDerivativesDag, on polynomials (no division) and on rational expressions
+static void benchHigherOrders(BenchConfig *cfg, NodeArena *base, NodeArena *work) {
+  static const char *kinds[2] = {"polynomial", "rational"};
+  static const int mixes[2][4] = {{1, 1, 1, 0}, {1, 1, 1, 1}};
+  DagStore dag = newDagStore();
+  NodeBudget budget = newNodeBudget(BENCH_ORDER_NODES, 0);
+  char *x = internIdentifier("x", 1);
+  for (int kind = 0; kind < 2; kind++) {
+    BenchConfig c = *cfg;
+    c.count = BENCH_FORMULAS;
+    memcpy(c.mix, mixes[kind], sizeof(c.mix));
+    useArena(base);
+    Workload w = makeWorkload(&c, c.identifiers, cfg->seed + 2 + kind);
+    useArena(NULL);
+    int treeFits = 1;
+    for (int n = 1; n <= BENCH_ORDER; n++) {
+      for (int useDag = 0; useDag < 2; useDag++) {
+        if (!useDag && !treeFits) {
+          continue;
+        }
+        double best = 0;
+        for (int r = 0; r < cfg->runs; r++) {
+          double ns = useDag ? timeDagOrders(&w, n, &dag, x) : timeTreeOrders(&w, n, work, &budget, x);
+          if (ns < 0) {
+            break;
+          }
+          if (r == 0 || ns < best) {
+            best = ns;
+          }
+        }
+        char name[64];
+        snprintf(name, sizeof(name), "higher_order_%s_%s_n%d", kinds[kind], useDag ? "dag" : "tree", n);
+        if (best <= 0) {
+          //The orders above n need even more nodes
+          fprintf(stderr, "%s: an expression needs more than %ld nodes, higher orders skipped\n",
+                  name, BENCH_ORDER_NODES);
+          treeFits = 0;
+        } else {
+          report(&c, name, w.count, w.nodes, best);
+        }
+      }
+    }
+    freeWorkload(&w);
+  }
+  freeDagStore(&dag);
+}
+
+// Runs the batch mode on all expressions with 1, 2, 4, ... up to cfg->workers threads
+static void benchBatch(BenchConfig *cfg, Workload *wp) {
+  FILE *in = tmpfile();
+  FILE *sink = fopen("/dev/null", "w");
+  if (in == NULL || sink == NULL) {
+    fprintf(stderr, "batch benchmark skipped, no temporary file\n");
+    return;
+  }
+  for (int i = 0; i < wp->count; i++) {
+    fprintf(in, "%s\n", wp->texts[i]);
+  }
+  fflush(in);
+  for (int workers = 1; workers <= cfg->workers; workers *= 2) {
+    BatchOptions options = defaultBatchOptions();
+    options.workers = workers;
+    double best = 0;
+    for (int r = 0; r < cfg->runs; r++) {
+      rewind(in);
+      double start = nowNs();
+      if (workers > 1) {
+        infixExpParallel(in, sink, &options);
+      } else {
+        infixExpBatch(in, sink, &options);
+      }
+      double ns = nowNs() - start;
+      if (r == 0 || ns < best) {
+        best = ns;
+      }
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "batch_j%d", workers);
+    report(cfg, name, wp->count, wp->nodes, best);
+  }
+  fclose(in);
+  fclose(sink);
+}
+
+// Runs the batch mode on a skewed input, without and with a result cache: every line repeats
+// one of the expressions, with the low indices picked far more often than the high ones
+static void benchSkewed(BenchConfig *cfg, Workload *wp) {
+  FILE *in = tmpfile();
+  FILE *sink = fopen("/dev/null", "w");
+  if (in == NULL || sink == NULL) {
+    fprintf(stderr, "skewed batch benchmark skipped, no temporary file\n");
+    return;
+  }
+  unsigned long state = cfg->seed + 2;
+  long nodes = 0;
+  for (int i = 0; i < wp->count; i++) {
+    int k = randomBelow(&state, 1 + randomBelow(&state, 1 + randomBelow(&state, wp->count)));
+    fprintf(in, "%s\n", wp->texts[k]);
+    nodes += sizeExpTree(wp->trees[k]);
+  }
+  fflush(in);
+  for (int cached = 0; cached < 2; cached++) {
+    BatchOptions options = defaultBatchOptions();
+    options.resultCapacity = cached ? BENCH_RESULTS : 0;
+    double best = 0;
+    for (int r = 0; r < cfg->runs; r++) {
+      rewind(in);
+      double start = nowNs();
+      infixExpBatch(in, sink, &options);
+      double ns = nowNs() - start;
+      if (r == 0 || ns < best) {
+        best = ns;
+      }
+    }
+    report(cfg, cached ? "batch_skewed_cached" : "batch_skewed", wp->count, nodes, best);
+  }
+  fclose(in);
+  fclose(sink);
+}
+
+// Compares getting the trees of all expressions by scanning and parsing their text with opening
+// a library of them and expanding its formulas. testInfix.c checks that the trees read back are
+// the ones written
+static void benchLibrary(BenchConfig *cfg, Workload *wp, NodeArena *work) {
+  FILE *fp = tmpfile();
+  if (fp == NULL) {
+    fprintf(stderr, "library benchmark skipped, no temporary file\n");
+    return;
+  }
+  LibraryWriter writer = newLibraryWriter();
+  for (int i = 0; i < wp->count; i++) {
+    addLibraryFormula(&writer, wp->trees[i]);
+  }
+  writeLibrary(&writer, fp);
+  freeLibraryWriter(&writer);
+  Scanner scanner = newScanner();
+  for (int kind = 0; kind < 2; kind++) {
+    double best = 0;
+    for (int r = 0; r < cfg->runs; r++) {
+      useArena(work);
+      double start = nowNs();
+      if (kind == 0) {
+        for (int i = 0; i < wp->count; i++) {
+          ExpTree t;
+          int errorPos;
+          parseTokenArray(scanner.tokens, scanTokens(&scanner, wp->texts[i], strlen(wp->texts[i])), &t, &errorPos);
+        }
+      } else {
+        TreeLibrary library;
+        rewind(fp);
+        if (!openLibrary(&library, fp)) {
+          fprintf(stderr, "library benchmark: the library cannot be opened\n");
+          break;
+        }
+        for (int i = 0; i < wp->count; i++) {
+          expandLibraryFormula(&library, i);
+        }
+        closeLibrary(&library);
+      }
+      double ns = nowNs() - start;
+      resetArena(work);
+      useArena(NULL);
+      if (r == 0 || ns < best) {
+        best = ns;
+      }
+    }
+    report(cfg, kind ? "library_expand" : "library_parse", wp->count, wp->nodes, best);
+  }
+  freeScanner(&scanner);
+  fclose(fp);
+}
+
+// Runs the pipeline of the batch mode on one expression nested deepDepth levels deep
+static void benchDeep(BenchConfig *cfg) {
+  if (cfg->deepDepth <= 0) {
+    return;
+  }
+  OutBuffer text = newOutBuffer(4 * cfg->deepDepth + 16);
+  for (int i = 0; i < cfg->deepDepth; i++) {
+    appendChar(&text, '(');
+  }
+  appendChar(&text, 'x');
+  for (int i = 0; i < cfg->deepDepth; i++) {
+    appendString(&text, i % 2 == 0 ? " + x)" : " - 1)");
+  }
+  Scanner scanner = newScanner();
+  NodeArena arena = newArena();
+  OutBuffer out = newOutBuffer(1024);
+  double best = 0;
+  for (int r = 0; r < cfg->runs; r++) {
+    int differingVariable = 1, errorPos = 0;
+    ExpTree t = NULL;
+    useArena(&arena);
+    double start = nowNs();
+    int k = scanTokens(&scanner, text.data, text.len);
+    if (parseTokenArray(scanner.tokens, k, &t, &errorPos)) {
+      t = simplify(t);
+      differentiate(&t, &differingVariable);
+      t = simplify(t);
+      appendExpTreeInfix(&out, t);
+    }
+    double ns = nowNs() - start;
+    out.len = 0;
+    resetArena(&arena);
+    useArena(NULL);
+    if (r == 0 || ns < best) {
+      best = ns;
+    }
+  }
+  report(cfg, "deep", 1, 2.0 * cfg->deepDepth + 1, best);
+  freeScanner(&scanner);
+  freeArena(&arena);
+  freeOutBuffer(&out);
+  freeOutBuffer(&text);
+}
+
+// Reads the options, returns 0 on a wrong one
+static int readOptions(int argc, char *argv[], BenchConfig *cfg) {
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      return 0;
+    }
+    char *arg = argv[i + 1];
+    if (strcmp(argv[i], "-n") == 0) {
+      cfg->count = atoi(arg);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      cfg->size = atoi(arg);
+    } else if (strcmp(argv[i], "-d") == 0) {
+      cfg->depth = atoi(arg);
+    } else if (strcmp(argv[i], "-m") == 0) {
+      if (sscanf(arg, "%d,%d,%d,%d", &cfg->mix[0], &cfg->mix[1], &cfg->mix[2], &cfg->mix[3]) != 4) {
+        return 0;
+      }
+    } else if (strcmp(argv[i], "-i") == 0) {
+      cfg->identifiers = atoi(arg);
+    } else if (strcmp(argv[i], "-r") == 0) {
+      cfg->seed = strtoul(arg, NULL, 10);
+    } else if (strcmp(argv[i], "-t") == 0) {
+      cfg->runs = atoi(arg);
+    } else if (strcmp(argv[i], "-j") == 0) {
+      cfg->workers = atoi(arg);
+    } else if (strcmp(argv[i], "-D") == 0) {
+      cfg->deepDepth = atoi(arg);
+    } else if (strcmp(argv[i], "-o") == 0) {
+      cfg->out = fopen(arg, "w");
+      if (cfg->out == NULL) {
+        return 0;
+      }
+    } else {
+      return 0;
+    }
+    i++;
+  }
+  int total = cfg->mix[0] + cfg->mix[1] + cfg->mix[2] + cfg->mix[3];
+  return cfg->count > 0 && cfg->size > 0 && cfg->depth > 0 && cfg->runs > 0 && total > 0 &&
+         cfg->mix[0] >= 0 && cfg->mix[1] >= 0 && cfg->mix[2] >= 0 && cfg->mix[3] >= 0 &&
+         cfg->identifiers >= 0 && cfg->identifiers <= 64;
+}
+
+int main(int argc, char *argv[]) {
+  BenchConfig cfg = {2000, 63, 32, {1, 1, 1, 1}, 3, 1, 3, 4, 1000000, NULL};
+  if (!readOptions(argc, argv, &cfg)) {
+    fprintf(stderr, "usage: %s [-n count] [-s size] [-d depth] [-m w+,w-,w*,w/] [-i identifiers] "
+            "[-r seed] [-t runs] [-j workers] [-D deepDepth] [-o file]\n", argv[0]);
+    return 1;
+  }
+  //printExpTreeInfix writes to stdout, which is sent to /dev/null, the records keep the real stdout
+  if (cfg.out == NULL) {
+    cfg.out = fdopen(dup(STDOUT_FILENO), "w");
+  }
+  if (cfg.out == NULL || freopen("/dev/null", "w", stdout) == NULL) {
+    fprintf(stderr, "cannot redirect the output\n");
+    return 1;
+  }
+  for (int k = 0; k < 64; k++) {
+    if (k == 0) {
+      strcpy(identifierNames[k], "x");
+    } else {
+      snprintf(identifierNames[k], sizeof(identifierNames[k]), "v%d", k);
+    }
+  }
+
+  NodeArena base = newArena();
+  useArena(&base);
+  Workload w = makeWorkload(&cfg, cfg.identifiers, cfg.seed);
+  Bench b;
+  b.wp = &w;
+  b.simplified = malloc((w.count + 1) * sizeof(ExpTree));
+  b.copies = malloc((w.count + 1) * sizeof(ExpTree));
+  b.flats = malloc((w.count + 1) * sizeof(FlatTree));
+  assert(b.simplified != NULL && b.copies != NULL && b.flats != NULL);
+  for (int i = 0; i < w.count; i++) {
+    b.simplified[i] = simplify(duplicate(w.trees[i]));
+    b.flats[i] = newFlatTree();
+    flattenExpTree(&b.flats[i], w.trees[i]);
+  }
+  useArena(NULL);
+  b.work = newArena();
+  b.scanner = newScanner();
+  b.dag = newDagStore();
+  b.cache = newDerivCache(4096);
+  b.cse = newCseResult();
+  b.out = newOutBuffer(1024);
+  b.x = internIdentifier("x", 1);
+  b.missCounter = openMissCounter();
+  b.misses = -1;
+
+  for (Stage s = 0; s < StageCount; s++) {
+    benchStage(&cfg, &b, s);
+  }
+  benchValues(&cfg, &base);
+  benchRows(&cfg, &w);
+  benchSpecialize(&cfg, &w, &b.work);
+  benchGradients(&cfg, &w, &b.work);
+  benchHigherOrders(&cfg, &base, &b.work);
+  benchBatch(&cfg, &w);
+  benchSkewed(&cfg, &w);
+  benchLibrary(&cfg, &w, &b.work);
+  benchDeep(&cfg);
+
+  for (int i = 0; i < w.count; i++) {
+    freeFlatTree(&b.flats[i]);
+  }
+  free(b.flats);
+  free(b.simplified);
+  free(b.copies);
+  freeArena(&b.work);
+  freeScanner(&b.scanner);
+  freeDagStore(&b.dag);
+  freeDerivCache(&b.cache);
+  freeCseResult(&b.cse);
+  freeOutBuffer(&b.out);
+  if (b.missCounter >= 0) {
+    close(b.missCounter);
+  }
+  freeWorkload(&w);
+  freeArena(&base);
+  freeSpareStacks();
+  fclose(cfg.out);
+  return 0;
+}
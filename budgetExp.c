@@ -0,0 +1,142 @@
+/* file : budgetExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Node and memory budget of a single expression. Differentiating duplicates subtrees, so some
+  inputs grow without bound. While a budget is active every tree or DAG node is charged to it,
+  together with the scratch arrays (stacks and memo tables) that are alive. When a charge of
+  nodes passes a limit the scratch arrays are freed and the computation jumps back to the setjmp
+  of the budget, the caller then releases the nodes by resetting its arena and DAG store. Caches
+  are not part of the expression, their copies are not charged (see derivCache.c).
+  Every thread has its own active budget.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include "budgetExp.h"
+
+typedef struct ScratchBlock {
+  void *p;
+  size_t size;
+} ScratchBlock;
+
+static _Thread_local NodeBudget *activeBudget = NULL;
+// The scratch arrays allocated since the budget was started and not freed yet
+static _Thread_local ScratchBlock scratch[BUDGET_SCRATCH];
+static _Thread_local int scratchCount = 0;
+
+// Creates a budget of maxNodes nodes and maxBytes bytes, 0 means no limit
+NodeBudget newNodeBudget(long maxNodes, long maxBytes) {
+  NodeBudget b;
+  b.maxNodes = maxNodes;
+  b.maxBytes = maxBytes;
+  b.nodes = 0;
+  b.bytes = 0;
+  b.exceededCount = 0;
+  return b;
+}
+
+// Checks if the budget has any limit
+int isBudgetLimited(NodeBudget *bp) {
+  return bp->maxNodes > 0 || bp->maxBytes > 0;
+}
+
+// Makes bp the active budget of this thread, with nothing charged yet.
+// The caller must have done setjmp(bp->exceeded)
+void startBudget(NodeBudget *bp) {
+  bp->nodes = 0;
+  bp->bytes = 0;
+  scratchCount = 0;
+  activeBudget = bp;
+}
+
+// Ends the active budget, arrays tracked since are left to their owners
+void stopBudget() {
+  activeBudget = NULL;
+  scratchCount = 0;
+}
+
+// Checks if this thread has an active budget
+int isBudgetActive() {
+  return activeBudget != NULL;
+}
+
+// Frees the tracked scratch arrays, ends the budget and jumps back to its setjmp
+static void exceedBudget() {
+  NodeBudget *bp = activeBudget;
+  while (scratchCount > 0) {
+    scratchCount--;
+    free(scratch[scratchCount].p);
+  }
+  activeBudget = NULL;
+  bp->exceededCount++;
+  longjmp(bp->exceeded, 1);
+}
+
+// Checks the limits of the active budget
+static void checkBudget(NodeBudget *bp) {
+  if ((bp->maxNodes > 0 && bp->nodes > bp->maxNodes) || (bp->maxBytes > 0 && bp->bytes > bp->maxBytes)) {
+    exceedBudget();
+  }
+}
+
+// Charges nodes taking bytes to the active budget, called before the nodes are made
+void chargeBudget(long nodes, long bytes) {
+  NodeBudget *bp = activeBudget;
+  if (bp == NULL) {
+    return;
+  }
+  bp->nodes += nodes;
+  bp->bytes += bytes;
+  checkBudget(bp);
+}
+
+// Returns the index of p among the tracked arrays, -1 if it is not tracked.
+// Arrays are mostly freed in the reverse order of allocation, so the search starts at the end
+static int findScratch(void *p) {
+  for (int i = scratchCount - 1; i >= 0; i--) {
+    if (scratch[i].p == p) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Returns the number of nodes charged to the active budget so far, 0 without one
+long chargedNodes() {
+  return activeBudget == NULL ? 0 : activeBudget->nodes;
+}
+
+// Tracks a scratch array of size bytes that was just allocated, so it is freed when the
+// budget is exceeded. The bytes count from now on, but the limits are only checked when nodes
+// are charged: a stack that grows never jumps out of its own allocation while arrays of its
+// caller that are not tracked are still alive
+void trackScratch(void *p, size_t size) {
+  NodeBudget *bp = activeBudget;
+  if (bp == NULL) {
+    return;
+  }
+  assert(scratchCount < BUDGET_SCRATCH);
+  scratch[scratchCount].p = p;
+  scratch[scratchCount].size = size;
+  scratchCount++;
+  bp->bytes += size;
+}
+
+// Stops tracking p, which is about to be freed or handed to another owner
+void untrackScratch(void *p) {
+  NodeBudget *bp = activeBudget;
+  if (bp == NULL) {
+    return;
+  }
+  int i = findScratch(p);
+  if (i < 0) {
+    return;
+  }
+  bp->bytes -= scratch[i].size;
+  scratchCount--;
+  scratch[i] = scratch[scratchCount];
+}
@@ -0,0 +1,31 @@
+#ifndef BUDGETEXP_H
+#define BUDGETEXP_H
+
+#include <stddef.h>
+#include <setjmp.h>
+
+// Most scratch arrays that can be alive at the same time while a budget is active
+#define BUDGET_SCRATCH 64
+
+// Limits of the nodes and bytes a single expression may take, 0 means no limit. When a limit
+// is passed the computation jumps back to the setjmp on exceeded
+typedef struct NodeBudget {
+  long maxNodes;
+  long maxBytes;
+  long nodes;
+  long bytes;
+  long exceededCount;
+  jmp_buf exceeded;
+} NodeBudget;
+
+NodeBudget newNodeBudget(long maxNodes, long maxBytes);
+int isBudgetLimited(NodeBudget *bp);
+void startBudget(NodeBudget *bp);
+void stopBudget();
+int isBudgetActive();
+void chargeBudget(long nodes, long bytes);
+long chargedNodes();
+void trackScratch(void *p, size_t size);
+void untrackScratch(void *p);
+
+#endif
@@ -0,0 +1,221 @@
+/* file : bytecodeExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Compiles an expression tree (for instance the output of differentiate) to postfix code for a
+  stack machine, so one formula can be evaluated many times without walking the tree.
+  Identifiers are resolved to slots once, at compile time: runProgram reads the value of slot i
+  from vars[i], and programSlot tells which slot belongs to an identifier. Identifiers are
+  interned (see symbolTable.c), so the slot of an identifier is found by its id in slotOf.
+  The operations are done in the same order as valueExpTree does them, so the results are
+  bit-identical.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "symbolTable.h"
+#include "bytecodeExp.h"
+#include "instrumentExp.h"
+
+// Appends an instruction to the program
+static void emit(Program *pp, OpCode op, int slot, double number) {
+  if (pp->length == pp->size) {
+    pp->size = 2 * pp->size;
+    pp->code = realloc(pp->code, pp->size * sizeof(Instruction));
+    assert(pp->code != NULL);
+  }
+  pp->code[pp->length].op = op;
+  pp->code[pp->length].slot = slot;
+  pp->code[pp->length].number = number;
+  pp->length++;
+}
+
+// Returns the slot of an identifier, a new slot is added for an unknown one. slotOf[id] is the
+// slot of the identifier with that id, -1 if it has none, so no slot is searched for
+static int addSlot(Program *pp, char *name) {
+  int id = identifierId(name);
+  if (id >= pp->slotOfSize) {
+    int newSize = 2 * pp->slotOfSize > id ? 2 * pp->slotOfSize : id + 1;
+    pp->slotOf = realloc(pp->slotOf, newSize * sizeof(int));
+    assert(pp->slotOf != NULL);
+    for (int i = pp->slotOfSize; i < newSize; i++) {
+      pp->slotOf[i] = -1;
+    }
+    pp->slotOfSize = newSize;
+  }
+  if (pp->slotOf[id] >= 0) {
+    return pp->slotOf[id];
+  }
+  if (pp->nameCount == pp->nameSize) {
+    pp->nameSize = 2 * pp->nameSize;
+    pp->names = realloc(pp->names, pp->nameSize * sizeof(char *));
+    assert(pp->names != NULL);
+  }
+  pp->names[pp->nameCount] = name;
+  pp->slotOf[id] = pp->nameCount;
+  pp->nameCount++;
+  return pp->nameCount - 1;
+}
+
+// Creates an empty program
+Program newProgram() {
+  Program p;
+  p.size = 16;
+  p.code = malloc(p.size * sizeof(Instruction));
+  assert(p.code != NULL);
+  p.length = 0;
+  p.nameSize = 4;
+  p.names = malloc(p.nameSize * sizeof(char *));
+  assert(p.names != NULL);
+  p.nameCount = 0;
+  p.slotOf = NULL;
+  p.slotOfSize = 0;
+  p.maxDepth = 0;
+  return p;
+}
+
+// Replaces the code of the program by the code of the tree, the arrays of the program are reused.
+// The nodes are visited in postorder using two stacks, so trees of any depth can be compiled
+void compileInto(Program *pp, ExpTree tr) {
+  pp->length = 0;
+  //Only the entries of the previous slots are cleared, so a reuse costs no more than the code
+  for (int i = 0; i < pp->nameCount; i++) {
+    pp->slotOf[identifierId(pp->names[i])] = -1;
+  }
+  pp->nameCount = 0;
+  pp->maxDepth = 0;
+  int depth = 0;
+  Stack visit = newStack(20);
+  Stack postorder = newStack(20);
+  push(&visit, tr);
+  while (!isEmptyStack(visit)) {
+    ExpTree node = pop(&visit);
+    push(&postorder, node);
+    if (node->tt == Symbol) {
+      push(&visit, node->left);
+      push(&visit, node->right);
+    }
+  }
+  while (!isEmptyStack(postorder)) {
+    ExpTree node = pop(&postorder);
+    switch (node->tt) {
+      case Number:
+        emit(pp, OpNumber, 0, node->t.number);
+        depth++;
+        break;
+      case Identifier:
+        emit(pp, OpVariable, addSlot(pp, node->t.identifier), 0);
+        depth++;
+        break;
+      case Symbol:
+        switch (node->t.symbol) {
+          case '+':
+            emit(pp, OpAdd, 0, 0);
+            break;
+          case '-':
+            emit(pp, OpSub, 0, 0);
+            break;
+          case '*':
+            emit(pp, OpMul, 0, 0);
+            break;
+          case '/':
+            emit(pp, OpDiv, 0, 0);
+            break;
+          default:
+            abort();
+        }
+        depth--;
+        break;
+    }
+    if (depth > pp->maxDepth) {
+      pp->maxDepth = depth;
+    }
+  }
+  freeStack(visit);
+  freeStack(postorder);
+}
+
+// Compiles the tree to a program, the slots are numbered in order of first appearance
+Program compileExpTree(ExpTree tr) {
+  Program p = newProgram();
+  compileInto(&p, tr);
+  return p;
+}
+
+// Returns the slot of an interned identifier, or -1 if it does not occur in the program
+int programSlot(Program *pp, const char *name) {
+  int id = identifierId(name);
+  return id < pp->slotOfSize ? pp->slotOf[id] : -1;
+}
+
+// Runs the program with the value of slot i in vars[i] and returns the value of the expression
+double runProgram(Program *pp, const double *vars) {
+  INSTR_BEGIN(StageEvaluate);
+  double local[PROGRAM_STACK];
+  double *stack = local;
+  if (pp->maxDepth > PROGRAM_STACK) {
+    stack = malloc(pp->maxDepth * sizeof(double));
+    assert(stack != NULL);
+  }
+  int top = 0;
+  const Instruction *ip = pp->code;
+  const Instruction *end = pp->code + pp->length;
+  while (ip < end) {
+    switch (ip->op) {
+      case OpNumber:
+        stack[top] = ip->number;
+        top++;
+        break;
+      case OpVariable:
+        stack[top] = vars[ip->slot];
+        top++;
+        break;
+      case OpAdd:
+        top--;
+        stack[top - 1] = stack[top - 1] + stack[top];
+        break;
+      case OpSub:
+        top--;
+        stack[top - 1] = stack[top - 1] - stack[top];
+        break;
+      case OpMul:
+        top--;
+        stack[top - 1] = stack[top - 1] * stack[top];
+        break;
+      case OpDiv:
+        top--;
+        stack[top - 1] = stack[top - 1] / stack[top];
+        break;
+    }
+    ip++;
+  }
+  double result = 0;
+  if (top > 0) {
+    result = stack[top - 1];
+  }
+  if (stack != local) {
+    free(stack);
+  }
+  INSTR_END(StageEvaluate);
+  return result;
+}
+
+// Frees up the allocated space
+void freeProgram(Program *pp) {
+  free(pp->code);
+  free(pp->names);
+  free(pp->slotOf);
+  pp->code = NULL;
+  pp->names = NULL;
+  pp->slotOf = NULL;
+  pp->slotOfSize = 0;
+  pp->length = 0;
+  pp->nameCount = 0;
+}
@@ -0,0 +1,44 @@
+#ifndef BYTECODEEXP_H
+#define BYTECODEEXP_H
+
+#include "scanner.h"
+#include "prefixExp.h"
+
+// Programs needing at most this many stack entries are run without a malloc
+#define PROGRAM_STACK 64
+
+typedef enum OpCode {
+  OpNumber,
+  OpVariable,
+  OpAdd,
+  OpSub,
+  OpMul,
+  OpDiv
+} OpCode;
+
+typedef struct Instruction {
+  OpCode op;
+  int slot;
+  double number;
+} Instruction;
+
+typedef struct Program {
+  Instruction *code;
+  int length;
+  int size;
+  char **names;
+  int nameCount;
+  int nameSize;
+  int *slotOf;
+  int slotOfSize;
+  int maxDepth;
+} Program;
+
+Program newProgram();
+void compileInto(Program *pp, ExpTree tr);
+Program compileExpTree(ExpTree tr);
+int programSlot(Program *pp, const char *name);
+double runProgram(Program *pp, const double *vars);
+void freeProgram(Program *pp);
+
+#endif
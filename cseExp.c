@@ -0,0 +1,255 @@
+/* file : cseExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Common subexpression elimination. The expression is hash-consed in a DagStore (see dagExp.c),
+  so structurally equal subtrees become one node. Every operator node that is used more than once
+  is bound to a temporary _t0, _t1, ... and its uses are replaced by that identifier. Derivatives
+  benefit most, the product and quotient rules copy whole operands. The result is printed as
+  "let _t0 = ..., _t1 = ... in <body>" and valueCse computes every temporary only once.
+  Temporaries cannot clash with identifiers of the input, those always start with a letter.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "dagExp.h"
+#include "flatExp.h"
+#include "batchExp.h"
+#include "symbolTable.h"
+#include "cseExp.h"
+#include "budgetExp.h"
+
+// Creates an empty result, its arrays are reused by every following pass
+CseResult newCseResult() {
+  CseResult c;
+  c.size = 16;
+  c.bindings = malloc(c.size * sizeof(ExpTree));
+  c.names = malloc(c.size * sizeof(char *));
+  assert(c.bindings != NULL && c.names != NULL);
+  c.count = 0;
+  c.nameCount = 0;
+  c.body = NULL;
+  c.nodesBefore = 0;
+  c.nodesAfter = 0;
+  c.totalBefore = 0;
+  c.totalAfter = 0;
+  c.flat = newFlatTree();
+  return c;
+}
+
+// Counts how many distinct parents every node reachable from tr has in uses[id], and the number
+// of nodes of the tree the DAG stands for in treeSize[id]. A node goes back on the stack under a
+// child that is not counted yet, so it is counted after both of its children
+static void countUses(ExpTree tr, int *uses, long *treeSize) {
+  Stack todo = newStack(20);
+  push(&todo, tr);
+  while (!isEmptyStack(todo)) {
+    ExpTree node = pop(&todo);
+    int id = dagId(node);
+    if (treeSize[id] > 0) {
+      continue;
+    }
+    if (node->tt == Symbol) {
+      if (treeSize[dagId(node->left)] == 0) {
+        push(&todo, node);
+        push(&todo, node->left);
+        continue;
+      }
+      if (treeSize[dagId(node->right)] == 0) {
+        push(&todo, node);
+        push(&todo, node->right);
+        continue;
+      }
+      uses[dagId(node->left)]++;
+      uses[dagId(node->right)]++;
+      treeSize[id] = treeSize[dagId(node->left)] + treeSize[dagId(node->right)];
+    }
+    treeSize[id]++;
+  }
+  freeStack(todo);
+}
+
+// Adds a temporary for the tree t and returns its name
+static char *bindTemporary(CseResult *cr, ExpTree t) {
+  if (cr->count == cr->size) {
+    cr->size = 2 * cr->size;
+    cr->bindings = realloc(cr->bindings, cr->size * sizeof(ExpTree));
+    cr->names = realloc(cr->names, cr->size * sizeof(char *));
+    assert(cr->bindings != NULL && cr->names != NULL);
+  }
+  //The names _t0, _t1, ... are interned once and kept for the following passes
+  if (cr->count == cr->nameCount) {
+    char name[16];
+    int n = snprintf(name, sizeof(name), "_t%d", cr->count);
+    cr->names[cr->count] = internIdentifier(name, n);
+    cr->nameCount++;
+  }
+  cr->bindings[cr->count] = t;
+  cr->count++;
+  return cr->names[cr->count - 1];
+}
+
+// Checks if the tree of a DAG node can be made at once: it is a leaf, it is bound already or
+// built[id] holds its tree
+static int isRebuilt(ExpTree tr, char **temp, ExpTree *built) {
+  int id = dagId(tr);
+  return tr->tt != Symbol || temp[id] != NULL || built[id] != NULL;
+}
+
+// Returns the tree of a DAG node for which isRebuilt holds, a bound node becomes its temporary
+static ExpTree rebuiltTree(ExpTree tr, char **temp, ExpTree *built) {
+  int id = dagId(tr);
+  Token t;
+  if (temp[id] != NULL) {
+    t.identifier = temp[id];
+    return newTreeNode(Identifier, t, NULL, NULL);
+  }
+  if (tr->tt != Symbol) {
+    return newTreeNode(tr->tt, tr->t, NULL, NULL);
+  }
+  return built[id];
+}
+
+// Builds the tree of a DAG node with every shared operator node replaced by its temporary,
+// temp[id] is the temporary of a node that is bound already. The nodes are taken from a stack
+// like in countUses, built[id] holds the tree of a node that is used only once until its parent
+// takes it
+static ExpTree rebuild(CseResult *cr, ExpTree tr, int *uses, char **temp, ExpTree *built) {
+  Stack todo = newStack(20);
+  if (!isRebuilt(tr, temp, built)) {
+    push(&todo, tr);
+  }
+  while (!isEmptyStack(todo)) {
+    ExpTree node = pop(&todo);
+    if (isRebuilt(node, temp, built)) {
+      continue;
+    }
+    if (!isRebuilt(node->left, temp, built)) {
+      push(&todo, node);
+      push(&todo, node->left);
+      continue;
+    }
+    if (!isRebuilt(node->right, temp, built)) {
+      push(&todo, node);
+      push(&todo, node->right);
+      continue;
+    }
+    ExpTree tL = rebuiltTree(node->left, temp, built);
+    ExpTree tR = rebuiltTree(node->right, temp, built);
+    ExpTree copy = newTreeNode(Symbol, node->t, tL, tR);
+    int id = dagId(node);
+    if (uses[id] < 2) {
+      built[id] = copy;
+    } else {
+      //The children are bound before their parent, so every binding only uses earlier temporaries
+      temp[id] = bindTemporary(cr, copy);
+    }
+  }
+  freeStack(todo);
+  return rebuiltTree(tr, temp, built);
+}
+
+// Eliminates the common subexpressions of the DAG node root of the store sp. The trees of the
+// result are made with newTreeNode, in the active arena if there is one. The node counts are
+// added to the totals of cr
+void cseDag(CseResult *cr, DagStore *sp, ExpTree root) {
+  cr->count = 0;
+  cr->body = NULL;
+  cr->nodesBefore = 0;
+  cr->nodesAfter = 0;
+  if (root == NULL) {
+    return;
+  }
+  //Every array is tracked right after its allocation, so none is lost when the budget is exceeded
+  int *uses = calloc(sp->count, sizeof(int));
+  assert(uses != NULL);
+  trackScratch(uses, sp->count * sizeof(int));
+  long *treeSize = calloc(sp->count, sizeof(long));
+  assert(treeSize != NULL);
+  trackScratch(treeSize, sp->count * sizeof(long));
+  char **temp = calloc(sp->count, sizeof(char *));
+  assert(temp != NULL);
+  trackScratch(temp, sp->count * sizeof(char *));
+  ExpTree *built = calloc(sp->count, sizeof(ExpTree));
+  assert(built != NULL);
+  trackScratch(built, sp->count * sizeof(ExpTree));
+  countUses(root, uses, treeSize);
+  cr->nodesBefore = treeSize[dagId(root)];
+  cr->body = rebuild(cr, root, uses, temp, built);
+  cr->nodesAfter = sizeExpTree(cr->body);
+  for (int k = 0; k < cr->count; k++) {
+    cr->nodesAfter += sizeExpTree(cr->bindings[k]);
+  }
+  cr->totalBefore += cr->nodesBefore;
+  cr->totalAfter += cr->nodesAfter;
+  untrackScratch(uses);
+  untrackScratch(treeSize);
+  untrackScratch(temp);
+  untrackScratch(built);
+  free(uses);
+  free(treeSize);
+  free(temp);
+  free(built);
+}
+
+// Eliminates the common subexpressions of an expression tree, sp is used for hash-consing it
+void cseExpTree(CseResult *cr, DagStore *sp, ExpTree tr) {
+  cseDag(cr, sp, dagFromTree(sp, tr));
+}
+
+// Appends the result as "let _t0 = ..., _t1 = ... in <body>", or only the body if there are no
+// temporaries
+void appendCseInfix(OutBuffer *bp, CseResult *cr) {
+  if (cr->body == NULL) {
+    return;
+  }
+  for (int k = 0; k < cr->count; k++) {
+    appendString(bp, k == 0 ? "let " : ", ");
+    appendString(bp, cr->names[k]);
+    appendString(bp, " = ");
+    appendExpTreeInfix(bp, cr->bindings[k]);
+  }
+  if (cr->count > 0) {
+    appendString(bp, " in ");
+  }
+  appendExpTreeInfix(bp, cr->body);
+}
+
+// Returns the value of the result. The identifier with id k has the value vars[k], vars must
+// have room for identifierCount() values: the temporaries are stored in it as they are computed
+double valueCse(CseResult *cr, double *vars) {
+  for (int k = 0; k < cr->count; k++) {
+    flattenExpTree(&cr->flat, cr->bindings[k]);
+    vars[identifierId(cr->names[k])] = valueFlatTree(&cr->flat, vars);
+  }
+  flattenExpTree(&cr->flat, cr->body);
+  return valueFlatTree(&cr->flat, vars);
+}
+
+// Prints the node counts before and after all passes done with cr
+void printCseStats(FILE *fp, CseResult *cr) {
+  fprintf(fp, "common subexpressions: %ld nodes before, %ld after (%.1f%%)\n",
+          cr->totalBefore, cr->totalAfter,
+          cr->totalBefore == 0 ? 100.0 : 100.0 * cr->totalAfter / cr->totalBefore);
+}
+
+// Frees up the allocated space, the trees are not freed
+void freeCseResult(CseResult *cr) {
+  free(cr->bindings);
+  free(cr->names);
+  freeFlatTree(&cr->flat);
+  cr->bindings = NULL;
+  cr->names = NULL;
+  cr->count = 0;
+  cr->size = 0;
+  cr->nameCount = 0;
+  cr->body = NULL;
+}
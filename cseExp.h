@@ -0,0 +1,35 @@
+#ifndef CSEEXP_H
+#define CSEEXP_H
+
+#include <stdio.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "dagExp.h"
+#include "flatExp.h"
+#include "batchExp.h"
+
+// An expression as a list of temporaries and a body: the temporary names[k] has the value of
+// bindings[k], which only uses temporaries before it, and the body may use all of them
+typedef struct CseResult {
+  ExpTree *bindings;
+  char **names;
+  int count;
+  int size;
+  int nameCount;
+  ExpTree body;
+  long nodesBefore;
+  long nodesAfter;
+  long totalBefore;
+  long totalAfter;
+  FlatTree flat;
+} CseResult;
+
+CseResult newCseResult();
+void cseDag(CseResult *cr, DagStore *sp, ExpTree root);
+void cseExpTree(CseResult *cr, DagStore *sp, ExpTree tr);
+void appendCseInfix(OutBuffer *bp, CseResult *cr);
+double valueCse(CseResult *cr, double *vars);
+void printCseStats(FILE *fp, CseResult *cr);
+void freeCseResult(CseResult *cr);
+
+#endif
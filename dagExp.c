@@ -0,0 +1,573 @@
+/* file : dagExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Hash-consed expression DAGs. A DagStore keeps exactly one node for every distinct subtree,
+  so equal subtrees are shared instead of copied. Nodes are never changed once created and live
+  as long as the store. differentiateDag therefore uses the original operands of a product or
+  quotient directly, where differentiate has to duplicate them, and the derivative of a shared
+  subtree is computed only once. dagOperation applies the rules of the simplifier in rewriteExp.c
+  while building, so the results of simplifyDag and differentiateDag are already simplified.
+  gradientDag and jacobianDag give the derivatives to many variables in a single traversal.
+  higherDerivativesDag gives the derivatives up to any order, each order sharing the nodes of
+  the one before it.
+  DAG nodes are ExpTrees and can be printed with printExpTreeInfix. Identifiers must be interned
+  (see symbolTable.c), equal names are the same pointer.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <math.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "symbolTable.h"
+#include "dagExp.h"
+#include "instrumentExp.h"
+#include "budgetExp.h"
+
+// Creates an empty store
+DagStore newDagStore() {
+  DagStore s;
+  s.tableSize = 1024;
+  s.table = calloc(s.tableSize, sizeof(DagNode *));
+  assert(s.table != NULL);
+  s.blocks = NULL;
+  s.blockUsed = DAG_BLOCK_NODES;
+  s.count = 0;
+  return s;
+}
+
+// Returns the id of a DAG node, ids are numbered 0, 1, 2, ... in order of creation
+int dagId(ExpTree tr) {
+  return ((DagNode *)tr)->id;
+}
+
+// Hashes the contents of a node, the children are canonical so their ids identify them
+static unsigned long hashNode(TokenType tt, Token t, ExpTree tL, ExpTree tR) {
+  unsigned long h = 1469598103934665603UL;
+  unsigned long payload = 0;
+  if (tt == Number) {
+    memcpy(&payload, &t.number, sizeof(double));
+  } else if (tt == Identifier) {
+    payload = identifierId(t.identifier);
+  } else {
+    payload = (unsigned char)t.symbol;
+  }
+  h = (h ^ tt) * 1099511628211UL;
+  h = (h ^ payload) * 1099511628211UL;
+  h = (h ^ (tL == NULL ? 0 : dagId(tL) + 1UL)) * 1099511628211UL;
+  h = (h ^ (tR == NULL ? 0 : dagId(tR) + 1UL)) * 1099511628211UL;
+  return h ^ (h >> 29);
+}
+
+// Checks if a node has the given contents
+static int sameNode(DagNode *n, TokenType tt, Token t, ExpTree tL, ExpTree tR) {
+  if (n->node.tt != tt || n->node.left != tL || n->node.right != tR) {
+    return 0;
+  }
+  switch (tt) {
+    case Number:
+      return memcmp(&n->node.t.number, &t.number, sizeof(double)) == 0;
+    case Identifier:
+      return n->node.t.identifier == t.identifier;
+    default:
+      return n->node.t.symbol == t.symbol;
+  }
+}
+
+// Doubles the number of buckets when the table gets full
+static void growTable(DagStore *sp) {
+  int newSize = 2 * sp->tableSize;
+  DagNode **table = calloc(newSize, sizeof(DagNode *));
+  assert(table != NULL);
+  for (int i = 0; i < sp->tableSize; i++) {
+    DagNode *n = sp->table[i];
+    while (n != NULL) {
+      DagNode *next = n->chain;
+      int b = n->hash & (newSize - 1);
+      n->chain = table[b];
+      table[b] = n;
+      n = next;
+    }
+  }
+  free(sp->table);
+  sp->table = table;
+  sp->tableSize = newSize;
+}
+
+// Returns the unique node with the given contents, it is created if it does not exist yet.
+// The children must be nodes of the same store
+ExpTree dagNode(DagStore *sp, TokenType tt, Token t, ExpTree tL, ExpTree tR) {
+  unsigned long h = hashNode(tt, t, tL, tR);
+  DagNode *n = sp->table[h & (sp->tableSize - 1)];
+  while (n != NULL) {
+    if (n->hash == h && sameNode(n, tt, t, tL, tR)) {
+      return &n->node;
+    }
+    n = n->chain;
+  }
+  //Charged before the store is changed, so an exceeded budget leaves a consistent store
+  chargeBudget(1, sizeof(DagNode));
+  if (sp->blockUsed == DAG_BLOCK_NODES) {
+    DagBlock *block = malloc(sizeof(DagBlock));
+    assert(block != NULL);
+    block->next = sp->blocks;
+    sp->blocks = block;
+    sp->blockUsed = 0;
+  }
+  n = &sp->blocks->nodes[sp->blockUsed];
+  sp->blockUsed++;
+  n->node.tt = tt;
+  n->node.t = t;
+  n->node.left = tL;
+  n->node.right = tR;
+  n->hash = h;
+  n->id = sp->count;
+  sp->count++;
+  int b = h & (sp->tableSize - 1);
+  n->chain = sp->table[b];
+  sp->table[b] = n;
+  if (sp->count > sp->tableSize) {
+    growTable(sp);
+  }
+  return &n->node;
+}
+
+// Returns the node of a number
+ExpTree dagNumber(DagStore *sp, double w) {
+  Token t;
+  t.number = w;
+  return dagNode(sp, Number, t, NULL, NULL);
+}
+
+// Returns the node of an identifier, name must be interned
+ExpTree dagIdentifier(DagStore *sp, char *name) {
+  Token t;
+  t.identifier = name;
+  return dagNode(sp, Identifier, t, NULL, NULL);
+}
+
+// Checks if the node is the number w
+static int isNumber(ExpTree tr, double w) {
+  return tr->tt == Number && tr->t.number == w;
+}
+
+// Splits a term in a numeric coefficient and the rest, like the like terms rule of rewriteExp.c
+static double coefficient(ExpTree tr, ExpTree *base) {
+  if (tr->tt == Symbol && tr->t.symbol == '*') {
+    if (tr->left->tt == Number) {
+      *base = tr->right;
+      return tr->left->t.number;
+    }
+    if (tr->right->tt == Number) {
+      *base = tr->left;
+      return tr->right->t.number;
+    }
+  }
+  *base = tr;
+  return 1;
+}
+
+// Returns the node of tL op tR, with the rules of the rule table of rewriteExp.c applied in the
+// same order. Equal subtrees are the same node, so the equality tests are pointer compares
+ExpTree dagOperation(DagStore *sp, char op, ExpTree tL, ExpTree tR) {
+  if (tL->tt == Number && tR->tt == Number) {
+    // Folds constants, division by zero is left for the evaluation to report and a quotient
+    // that is not a whole number stays n / m like in foldConstants of rewriteExp.c
+    double a = tL->t.number, b = tR->t.number;
+    switch (op) {
+      case '+':
+        return dagNumber(sp, a + b);
+      case '-':
+        return dagNumber(sp, a - b);
+      case '*':
+        return dagNumber(sp, a * b);
+      case '/':
+        if (b != 0 && fmod(a, b) == 0) {
+          return dagNumber(sp, a / b);
+        }
+        break;
+    }
+  }
+  switch (op) {
+    case '+':
+      // Recognizes exp + 0 and 0 + exp
+      if (isNumber(tR, 0)) {
+        return tL;
+      }
+      if (isNumber(tL, 0)) {
+        return tR;
+      }
+      break;
+    case '-':
+      // Recognizes exp - 0 and exp - exp
+      if (isNumber(tR, 0)) {
+        return tL;
+      }
+      if (tL == tR) {
+        return dagNumber(sp, 0);
+      }
+      break;
+    case '*':
+      // Recognizes exp * 1, 1 * exp, exp * 0 and 0 * exp
+      if (isNumber(tR, 1)) {
+        return tL;
+      }
+      if (isNumber(tL, 1)) {
+        return tR;
+      }
+      if (isNumber(tR, 0) || isNumber(tL, 0)) {
+        return dagNumber(sp, 0);
+      }
+      break;
+    case '/':
+      // Recognizes exp / 1, 0 / exp and exp / exp
+      if (isNumber(tR, 1)) {
+        return tL;
+      }
+      if (isNumber(tL, 0) && tR->tt != Number) {
+        return dagNumber(sp, 0);
+      }
+      if (tL == tR && tL->tt != Number) {
+        return dagNumber(sp, 1);
+      }
+      break;
+  }
+  if ((op == '+' || op == '-') && tL->tt != Number && tR->tt != Number) {
+    // Collects like terms c*e + d*e into (c + d) * e
+    ExpTree baseL, baseR;
+    double c = coefficient(tL, &baseL);
+    double d = coefficient(tR, &baseR);
+    if (baseL == baseR) {
+      return dagOperation(sp, '*', dagNumber(sp, op == '+' ? c + d : c - d), baseL);
+    }
+  }
+  Token t;
+  t.symbol = op;
+  return dagNode(sp, Symbol, t, tL, tR);
+}
+
+// Returns the DAG of an expression tree, equal subtrees of the tree become one node. The nodes
+// are visited in postorder using two stacks, the DAG nodes of the children are kept on a third
+ExpTree dagFromTree(DagStore *sp, ExpTree tr) {
+  if (tr == NULL) {
+    return NULL;
+  }
+  Stack visit = newStack(20);
+  Stack postorder = newStack(20);
+  Stack nodes = newStack(20);
+  push(&visit, tr);
+  while (!isEmptyStack(visit)) {
+    ExpTree node = pop(&visit);
+    push(&postorder, node);
+    if (node->left != NULL) {
+      push(&visit, node->left);
+    }
+    if (node->right != NULL) {
+      push(&visit, node->right);
+    }
+  }
+  //Children come off the stack before their parents, so the nodes of both children are on top
+  while (!isEmptyStack(postorder)) {
+    ExpTree node = pop(&postorder);
+    ExpTree tR = node->right == NULL ? NULL : pop(&nodes);
+    ExpTree tL = node->left == NULL ? NULL : pop(&nodes);
+    push(&nodes, dagNode(sp, node->tt, node->t, tL, tR));
+  }
+  ExpTree result = pop(&nodes);
+  freeStack(visit);
+  freeStack(postorder);
+  freeStack(nodes);
+  return result;
+}
+
+// Returns the simplified version of a node if it is known, a leaf is its own simplified version
+static ExpTree simplifiedOf(ExpTree tr, ExpTree *memo) {
+  return tr->tt == Symbol ? memo[dagId(tr)] : tr;
+}
+
+// Returns the simplified version of a DAG node. Every node is simplified once, memo[id] holds the
+// result of the nodes done so far. A node goes back on the stack under a child that is not done
+// yet, so it is taken again once that child is done
+ExpTree simplifyDag(DagStore *sp, ExpTree tr) {
+  INSTR_BEGIN(StageSimplify);
+  ExpTree *memo = calloc(sp->count, sizeof(ExpTree));
+  assert(memo != NULL);
+  trackScratch(memo, sp->count * sizeof(ExpTree));
+  Stack todo = newStack(20);
+  if (tr->tt == Symbol) {
+    push(&todo, tr);
+  }
+  while (!isEmptyStack(todo)) {
+    ExpTree node = pop(&todo);
+    if (memo[dagId(node)] != NULL) {
+      continue;
+    }
+    ExpTree tL = simplifiedOf(node->left, memo);
+    ExpTree tR = simplifiedOf(node->right, memo);
+    if (tL == NULL || tR == NULL) {
+      push(&todo, node);
+      push(&todo, tL == NULL ? node->left : node->right);
+      continue;
+    }
+    memo[dagId(node)] = dagOperation(sp, node->t.symbol, tL, tR);
+  }
+  freeStack(todo);
+  ExpTree result = simplifiedOf(tr, memo);
+  untrackScratch(memo);
+  free(memo);
+  INSTR_END(StageSimplify);
+  return result;
+}
+
+// Returns the derivative of a node if it is known. This derivates a constant to 0 and an
+// identifier to 1 if it is the variable, else to 0
+static ExpTree derivativeOf(DagStore *sp, ExpTree tr, char *var, ExpTree *memo) {
+  if (tr->tt == Number) {
+    return dagNumber(sp, 0);
+  }
+  if (tr->tt == Identifier) {
+    return dagNumber(sp, tr->t.identifier == var ? 1 : 0);
+  }
+  return memo[dagId(tr)];
+}
+
+// Differentiates every node below tr once, memo[id] holds the derivatives of the nodes done so
+// far. The nodes are taken from a stack like in simplifyDag
+static ExpTree differentiateDagNodes(DagStore *sp, ExpTree tr, char *var, ExpTree *memo) {
+  Stack todo = newStack(20);
+  if (tr->tt == Symbol) {
+    push(&todo, tr);
+  }
+  while (!isEmptyStack(todo)) {
+    ExpTree node = pop(&todo);
+    if (memo[dagId(node)] != NULL) {
+      continue;
+    }
+    ExpTree a = node->left, b = node->right;
+    ExpTree da = derivativeOf(sp, a, var, memo);
+    if (da == NULL) {
+      push(&todo, node);
+      push(&todo, a);
+      continue;
+    }
+    ExpTree db = derivativeOf(sp, b, var, memo);
+    if (db == NULL) {
+      push(&todo, node);
+      push(&todo, b);
+      continue;
+    }
+    ExpTree result;
+    switch (node->t.symbol) {
+      case '+':
+      case '-':
+        result = dagOperation(sp, node->t.symbol, da, db);
+        break;
+      case '*':
+        //(a*b)' = (a')*b + a*(b'), a and b are shared instead of duplicated
+        result = dagOperation(sp, '+', dagOperation(sp, '*', da, b), dagOperation(sp, '*', a, db));
+        break;
+      case '/':
+        //(a/b)' = ((a')*b - a*(b')) / (b*b)
+        result = dagOperation(sp, '/',
+                              dagOperation(sp, '-', dagOperation(sp, '*', da, b), dagOperation(sp, '*', a, db)),
+                              dagOperation(sp, '*', b, b));
+        break;
+      default:
+        abort();
+    }
+    memo[dagId(node)] = result;
+  }
+  freeStack(todo);
+  return derivativeOf(sp, tr, var, memo);
+}
+
+// Returns the simplified derivative of a DAG node to the interned identifier var
+ExpTree differentiateDag(DagStore *sp, ExpTree tr, char *var) {
+  INSTR_BEGIN(StageDifferentiate);
+  //Only nodes that exist before differentiating are ever differentiated
+  ExpTree *memo = calloc(sp->count, sizeof(ExpTree));
+  assert(memo != NULL);
+  trackScratch(memo, sp->count * sizeof(ExpTree));
+  ExpTree result = differentiateDagNodes(sp, tr, var, memo);
+  untrackScratch(memo);
+  free(memo);
+  INSTR_END(StageDifferentiate);
+  return result;
+}
+
+// Computes the derivatives of a DAG node up to order n to the interned identifier var: out[0]
+// is tr and out[k] the simplified k-th derivative, out must have room for n + 1 trees. Every
+// order is the derivative of the order before it in the same store, so it shares the nodes of
+// that order instead of copying them. The memo is kept from order to order, a node that is part
+// of several orders is differentiated only once. Every order is taken with the stack walk of
+// differentiateDag, so the depth of the orders is not limited by the C stack
+void higherDerivativesDag(DagStore *sp, ExpTree tr, char *var, int n, ExpTree *out) {
+  INSTR_BEGIN(StageDifferentiate);
+  out[0] = tr;
+  ExpTree *memo = NULL;
+  int memoSize = 0;
+  for (int k = 1; k <= n; k++) {
+    //The memo grows with the store, the nodes made by the previous order get empty entries
+    if (sp->count > memoSize) {
+      untrackScratch(memo);
+      memo = realloc(memo, sp->count * sizeof(ExpTree));
+      assert(memo != NULL);
+      trackScratch(memo, sp->count * sizeof(ExpTree));
+      memset(&memo[memoSize], 0, (sp->count - memoSize) * sizeof(ExpTree));
+      memoSize = sp->count;
+    }
+    out[k] = differentiateDagNodes(sp, out[k - 1], var, memo);
+  }
+  untrackScratch(memo);
+  free(memo);
+  INSTR_END(StageDifferentiate);
+}
+
+// Returns the partial derivatives of a node if they are known, memo[id * nVars + k] holds the
+// derivative of node id to vars[k]. A constant has only zero partial derivatives, an identifier
+// has 1 for its own variable, they are filled in the first time a leaf is asked for
+static ExpTree *partialsOf(DagStore *sp, ExpTree tr, char **vars, int nVars, ExpTree *memo) {
+  ExpTree *partials = &memo[(long)dagId(tr) * nVars];
+  if (partials[0] == NULL && tr->tt != Symbol) {
+    for (int k = 0; k < nVars; k++) {
+      partials[k] = dagNumber(sp, tr->tt == Identifier && tr->t.identifier == vars[k] ? 1 : 0);
+    }
+  }
+  return partials[0] == NULL ? NULL : partials;
+}
+
+// Differentiates every node below tr once to all nVars variables, all partial derivatives of a
+// node are computed at the same visit. The nodes are taken from a stack like in simplifyDag
+static ExpTree *gradientDagNodes(DagStore *sp, ExpTree tr, char **vars, int nVars, ExpTree *memo) {
+  Stack todo = newStack(20);
+  push(&todo, tr);
+  while (!isEmptyStack(todo)) {
+    ExpTree node = pop(&todo);
+    if (partialsOf(sp, node, vars, nVars, memo) != NULL) {
+      continue;
+    }
+    ExpTree a = node->left, b = node->right;
+    ExpTree *da = partialsOf(sp, a, vars, nVars, memo);
+    if (da == NULL) {
+      push(&todo, node);
+      push(&todo, a);
+      continue;
+    }
+    ExpTree *db = partialsOf(sp, b, vars, nVars, memo);
+    if (db == NULL) {
+      push(&todo, node);
+      push(&todo, b);
+      continue;
+    }
+    ExpTree *partials = &memo[(long)dagId(node) * nVars];
+    //b*b does not depend on the variable, it is made once for all of them
+    ExpTree bb = node->t.symbol == '/' ? dagOperation(sp, '*', b, b) : NULL;
+    for (int k = 0; k < nVars; k++) {
+      switch (node->t.symbol) {
+        case '+':
+        case '-':
+          partials[k] = dagOperation(sp, node->t.symbol, da[k], db[k]);
+          break;
+        case '*':
+          partials[k] = dagOperation(sp, '+', dagOperation(sp, '*', da[k], b), dagOperation(sp, '*', a, db[k]));
+          break;
+        case '/':
+          partials[k] = dagOperation(sp, '/',
+                                     dagOperation(sp, '-', dagOperation(sp, '*', da[k], b),
+                                                  dagOperation(sp, '*', a, db[k])),
+                                     bb);
+          break;
+        default:
+          abort();
+      }
+    }
+  }
+  freeStack(todo);
+  return partialsOf(sp, tr, vars, nVars, memo);
+}
+
+// Computes the Jacobian of the n DAG nodes trs to the nVars interned identifiers vars in one
+// traversal: out[i * nVars + k] is the simplified derivative of trs[i] to vars[k].
+// Every node shared by the expressions is differentiated once, to all variables at the same time
+void jacobianDag(DagStore *sp, ExpTree *trs, int n, char **vars, int nVars, ExpTree *out) {
+  if (nVars == 0) {
+    return;
+  }
+  INSTR_BEGIN(StageDifferentiate);
+  //Only nodes that exist before differentiating are ever differentiated
+  ExpTree *memo = calloc((long)sp->count * nVars, sizeof(ExpTree));
+  assert(memo != NULL);
+  trackScratch(memo, (long)sp->count * nVars * sizeof(ExpTree));
+  for (int i = 0; i < n; i++) {
+    ExpTree *partials = gradientDagNodes(sp, trs[i], vars, nVars, memo);
+    memcpy(&out[(long)i * nVars], partials, nVars * sizeof(ExpTree));
+  }
+  untrackScratch(memo);
+  free(memo);
+  INSTR_END(StageDifferentiate);
+}
+
+// Computes all nVars partial derivatives of a DAG node in one traversal, out[k] is the
+// simplified derivative to vars[k]
+void gradientDag(DagStore *sp, ExpTree tr, char **vars, int nVars, ExpTree *out) {
+  jacobianDag(sp, &tr, 1, vars, nVars, out);
+}
+
+// Returns the number of distinct nodes reachable from tr
+int dagSize(DagStore *sp, ExpTree tr) {
+  if (tr == NULL) {
+    return 0;
+  }
+  char *seen = calloc(sp->count + 1, 1);
+  assert(seen != NULL);
+  int size = 0;
+  Stack st = newStack(20);
+  push(&st, tr);
+  while (!isEmptyStack(st)) {
+    ExpTree node = pop(&st);
+    if (seen[dagId(node)]) {
+      continue;
+    }
+    seen[dagId(node)] = 1;
+    size++;
+    if (node->left != NULL) {
+      push(&st, node->left);
+    }
+    if (node->right != NULL) {
+      push(&st, node->right);
+    }
+  }
+  freeStack(st);
+  free(seen);
+  return size;
+}
+
+// Removes all nodes from the store, the first block and the table are kept for reuse
+void resetDagStore(DagStore *sp) {
+  while (sp->blocks != NULL && sp->blocks->next != NULL) {
+    DagBlock *next = sp->blocks->next;
+    free(sp->blocks);
+    sp->blocks = next;
+  }
+  sp->blockUsed = 0;
+  if (sp->blocks == NULL) {
+    sp->blockUsed = DAG_BLOCK_NODES;
+  }
+  sp->count = 0;
+  memset(sp->table, 0, sp->tableSize * sizeof(DagNode *));
+}
+
+// Frees up the allocated space
+void freeDagStore(DagStore *sp) {
+  resetDagStore(sp);
+  free(sp->blocks);
+  free(sp->table);
+  sp->blocks = NULL;
+  sp->table = NULL;
+}
@@ -0,0 +1,47 @@
+#ifndef DAGEXP_H
+#define DAGEXP_H
+
+#include "scanner.h"
+#include "prefixExp.h"
+
+// Number of DAG nodes carved out of a single malloc'ed block
+#define DAG_BLOCK_NODES 1024
+
+// A DagNode starts with an ExpTreeNode, so every DAG node can be used as an ExpTree
+typedef struct DagNode {
+  ExpTreeNode node;
+  unsigned long hash;
+  int id;
+  struct DagNode *chain;
+} DagNode;
+
+typedef struct DagBlock {
+  struct DagBlock *next;
+  DagNode nodes[DAG_BLOCK_NODES];
+} DagBlock;
+
+typedef struct DagStore {
+  DagNode **table;
+  int tableSize;
+  DagBlock *blocks;
+  int blockUsed;
+  int count;
+} DagStore;
+
+DagStore newDagStore();
+ExpTree dagNode(DagStore *sp, TokenType tt, Token t, ExpTree tL, ExpTree tR);
+ExpTree dagNumber(DagStore *sp, double w);
+ExpTree dagIdentifier(DagStore *sp, char *name);
+ExpTree dagOperation(DagStore *sp, char op, ExpTree tL, ExpTree tR);
+ExpTree dagFromTree(DagStore *sp, ExpTree tr);
+ExpTree simplifyDag(DagStore *sp, ExpTree tr);
+ExpTree differentiateDag(DagStore *sp, ExpTree tr, char *var);
+void higherDerivativesDag(DagStore *sp, ExpTree tr, char *var, int n, ExpTree *out);
+void gradientDag(DagStore *sp, ExpTree tr, char **vars, int nVars, ExpTree *out);
+void jacobianDag(DagStore *sp, ExpTree *trs, int n, char **vars, int nVars, ExpTree *out);
+int dagId(ExpTree tr);
+int dagSize(DagStore *sp, ExpTree tr);
+void resetDagStore(DagStore *sp);
+void freeDagStore(DagStore *sp);
+
+#endif
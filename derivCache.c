@@ -0,0 +1,359 @@
+/* file : derivCache.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Bounded cache of derivatives. An entry maps a subtree, found by its structural hash, and a
+  differentiation variable to the simplified derivative of that subtree. derivativeCached looks
+  up the expression and its subtrees of DERIV_CACHE_MIN_NODES to DERIV_CACHE_MAX_NODES nodes
+  (the expression also when it is smaller, never when it is larger), so subexpressions that
+  recur across many expressions are differentiated only once. When the cache is full the least
+  recently used entry is evicted to make room for a new one. Entries keep their own malloc'ed
+  copies of the trees, so they outlive the arena of the expression they came from. All walks
+  over the trees use explicit stacks, the depth of an expression is not limited by the C stack.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "rewriteExp.h"
+#include "derivCache.h"
+#include "instrumentExp.h"
+#include "budgetExp.h"
+
+// Creates an empty cache holding at most capacity derivatives
+DerivCache newDerivCache(int capacity) {
+  DerivCache c;
+  c.tableSize = 64;
+  while (c.tableSize < capacity) {
+    c.tableSize = 2 * c.tableSize;
+  }
+  c.table = calloc(c.tableSize, sizeof(CacheEntry *));
+  assert(c.table != NULL);
+  c.newest = NULL;
+  c.oldest = NULL;
+  c.count = 0;
+  c.capacity = capacity;
+  c.hits = 0;
+  c.misses = 0;
+  c.evictions = 0;
+  return c;
+}
+
+// Copies a tree of n nodes with malloc'ed nodes, independent of any arena. Identifiers are
+// interned and shared. The nodes still to be copied and their copies are kept in pairs on a
+// single array, like the two stacks of duplicate
+static ExpTree copyOwned(ExpTree tr, int n) {
+  if (tr == NULL) {
+    return NULL;
+  }
+  ExpTree *pending = malloc(2 * n * sizeof(ExpTree));
+  assert(pending != NULL);
+  ExpTree root = malloc(sizeof(ExpTreeNode));
+  assert(root != NULL);
+  int top = 0;
+  pending[top++] = tr;
+  pending[top++] = root;
+  while (top > 0) {
+    ExpTree to = pending[--top];
+    ExpTree from = pending[--top];
+    to->tt = from->tt;
+    to->t = from->t;
+    to->left = NULL;
+    to->right = NULL;
+    if (from->left != NULL) {
+      to->left = malloc(sizeof(ExpTreeNode));
+      assert(to->left != NULL);
+      pending[top++] = from->left;
+      pending[top++] = to->left;
+    }
+    if (from->right != NULL) {
+      to->right = malloc(sizeof(ExpTreeNode));
+      assert(to->right != NULL);
+      pending[top++] = from->right;
+      pending[top++] = to->right;
+    }
+  }
+  free(pending);
+  return root;
+}
+
+// Frees a tree made by copyOwned. A left child is rotated up until the node has none, so the
+// tree is freed without a stack
+static void freeOwned(ExpTree tr) {
+  while (tr != NULL) {
+    if (tr->left != NULL) {
+      ExpTree left = tr->left;
+      tr->left = left->right;
+      left->right = tr;
+      tr = left;
+    } else {
+      ExpTree right = tr->right;
+      free(tr);
+      tr = right;
+    }
+  }
+}
+
+// Unlinks an entry from the list of entries ordered by last use
+static void unlinkEntry(DerivCache *cp, CacheEntry *e) {
+  if (e->newer != NULL) {
+    e->newer->older = e->older;
+  } else {
+    cp->newest = e->older;
+  }
+  if (e->older != NULL) {
+    e->older->newer = e->newer;
+  } else {
+    cp->oldest = e->newer;
+  }
+}
+
+// Makes an entry the most recently used one
+static void linkNewest(DerivCache *cp, CacheEntry *e) {
+  e->newer = NULL;
+  e->older = cp->newest;
+  if (cp->newest != NULL) {
+    cp->newest->newer = e;
+  } else {
+    cp->oldest = e;
+  }
+  cp->newest = e;
+}
+
+// Removes the least recently used entry
+static void evictOldest(DerivCache *cp) {
+  CacheEntry *e = cp->oldest;
+  unlinkEntry(cp, e);
+  CacheEntry **link = &cp->table[e->hash & (cp->tableSize - 1)];
+  while (*link != e) {
+    link = &(*link)->chain;
+  }
+  *link = e->chain;
+  freeOwned(e->source);
+  freeOwned(e->derivative);
+  free(e);
+  cp->count--;
+  cp->evictions++;
+}
+
+// Returns the entry of tr and var, or NULL if the cache does not have it
+static CacheEntry *lookup(DerivCache *cp, unsigned long h, ExpTree tr, char *var) {
+  CacheEntry *e = cp->table[h & (cp->tableSize - 1)];
+  while (e != NULL) {
+    if (e->hash == h && e->var == var && equalExpTree(e->source, tr)) {
+      return e;
+    }
+    e = e->chain;
+  }
+  return NULL;
+}
+
+// Stores the derivative of tr to var, size is the number of nodes of tr and cost the number of
+// nodes charged to the budget while the derivative was computed. The copies are not charged, the
+// cache is not part of the expression. When the cache is full the least recently used entry
+// makes room, entries are never in use here because a hit is duplicated as soon as it is found
+static void insert(DerivCache *cp, unsigned long h, ExpTree tr, int size, char *var, ExpTree derivative, long cost) {
+  if (cp->capacity <= 0) {
+    return;
+  }
+  while (cp->count >= cp->capacity) {
+    evictOldest(cp);
+  }
+  CacheEntry *e = malloc(sizeof(CacheEntry));
+  assert(e != NULL);
+  e->hash = h;
+  e->var = var;
+  e->source = copyOwned(tr, size);
+  e->derivativeSize = sizeExpTree(derivative);
+  e->derivative = copyOwned(derivative, e->derivativeSize);
+  e->cost = cost;
+  int b = h & (cp->tableSize - 1);
+  e->chain = cp->table[b];
+  cp->table[b] = e;
+  linkNewest(cp, e);
+  cp->count++;
+}
+
+// Stores the subtrees of tr in preorder in nodes, with the hash and the size of each. The
+// subtree at index i has its left subtree at i + 1 and its right one at i + 1 + sizes[i + 1],
+// so going back from the last index every subtree comes after its children
+static void fillHashes(ExpTree tr, ExpTree *nodes, unsigned long *hashes, int *sizes) {
+  int n = 0;
+  Stack st = newStack(20);
+  push(&st, tr);
+  while (!isEmptyStack(st)) {
+    ExpTree node = pop(&st);
+    nodes[n] = node;
+    n++;
+    if (node->tt == Symbol) {
+      push(&st, node->right);
+      push(&st, node->left);
+    }
+  }
+  freeStack(st);
+  for (int i = n - 1; i >= 0; i--) {
+    if (nodes[i]->tt != Symbol) {
+      hashes[i] = hashExpNode(nodes[i], 0, 0);
+      sizes[i] = 1;
+    } else {
+      int l = i + 1, r = i + 1 + sizes[i + 1];
+      hashes[i] = hashExpNode(nodes[i], hashes[l], hashes[r]);
+      sizes[i] = 1 + sizes[l] + sizes[r];
+    }
+  }
+}
+
+// Checks if the subtree at preorder index i is looked up in and stored in the cache. The whole
+// expression (i is 0) may be smaller than DERIV_CACHE_MIN_NODES, but not larger than
+// DERIV_CACHE_MAX_NODES, so no entry keeps a copy of more nodes than that
+static int isCachedSize(int *sizes, int i) {
+  return (i == 0 || sizes[i] >= DERIV_CACHE_MIN_NODES) && sizes[i] <= DERIV_CACHE_MAX_NODES;
+}
+
+// Creates an operator node and simplifies it, its children are simplified already
+static ExpTree simplifiedOperation(char op, ExpTree tL, ExpTree tR) {
+  Token t;
+  t.symbol = op;
+  ExpTree new = newTreeNode(Symbol, t, tL, tR);
+  rewriteNode(new);
+  return new;
+}
+
+// Combines the derivatives da and db of the children of the operator node tr into its
+// simplified derivative, built in the active arena
+static ExpTree derivativeNode(ExpTree tr, ExpTree da, ExpTree db) {
+  ExpTree a = tr->left, b = tr->right;
+  switch (tr->t.symbol) {
+    case '+':
+    case '-':
+      return simplifiedOperation(tr->t.symbol, da, db);
+    case '*':
+      //Having the expression (a*b)' the formula used is (a')*b + a*(b')
+      return simplifiedOperation('+', simplifiedOperation('*', da, duplicate(b)),
+                                 simplifiedOperation('*', duplicate(a), db));
+    case '/':
+      //Having the expression (a/b)' the formula used is ((a')*b - a*(b')) / (b*b)
+      return simplifiedOperation('/',
+                                 simplifiedOperation('-', simplifiedOperation('*', da, duplicate(b)),
+                                                     simplifiedOperation('*', duplicate(a), db)),
+                                 simplifiedOperation('*', duplicate(b), duplicate(b)));
+    default:
+      abort();
+  }
+}
+
+// Returns the simplified derivative of tr to the interned identifier var, built in the active
+// arena. tr must be simplified, as infixExpTrees does before differentiating. The result equals
+// the one of differentiate followed by simplify.
+// The preorder indices still to be done are kept on the array todo, an operator whose children
+// are being differentiated is kept as -1 - i. The derivatives of the children done so far are
+// kept on a stack, the one of the right child on top.
+// A hit is charged to the budget what computing its derivative was, so whether an expression is
+// too large does not depend on what the cache holds
+ExpTree derivativeCached(DerivCache *cp, ExpTree tr, char *var) {
+  INSTR_BEGIN(StageDifferentiate);
+  int n = sizeExpTree(tr);
+  //The arrays are bookkeeping of the cache, they are tracked with 0 bytes so they are freed when
+  //the budget is exceeded without being charged to the expression
+  ExpTree *nodes = malloc(n * sizeof(ExpTree));
+  assert(nodes != NULL);
+  trackScratch(nodes, 0);
+  unsigned long *hashes = malloc(n * sizeof(unsigned long));
+  assert(hashes != NULL);
+  trackScratch(hashes, 0);
+  int *sizes = malloc(n * sizeof(int));
+  assert(sizes != NULL);
+  trackScratch(sizes, 0);
+  //charged[i] is the number of nodes charged before subtree i was differentiated
+  long *charged = malloc(n * sizeof(long));
+  assert(charged != NULL);
+  trackScratch(charged, 0);
+  //An index is taken from todo before its two children are put on it
+  int *todo = malloc((n + 1) * sizeof(int));
+  assert(todo != NULL);
+  trackScratch(todo, 0);
+  fillHashes(tr, nodes, hashes, sizes);
+  Stack derivatives = newStack(20);
+  Token t;
+  int top = 0;
+  todo[top++] = 0;
+  while (top > 0) {
+    int i = todo[--top];
+    if (i < 0) {
+      //Both children are done
+      i = -1 - i;
+      ExpTree db = pop(&derivatives);
+      ExpTree da = pop(&derivatives);
+      ExpTree result = derivativeNode(nodes[i], da, db);
+      if (isCachedSize(sizes, i)) {
+        insert(cp, hashes[i], nodes[i], sizes[i], var, result, chargedNodes() - charged[i]);
+      }
+      push(&derivatives, result);
+      continue;
+    }
+    ExpTree node = nodes[i];
+    //This derivates a constant to 0 and an identifier to 1 if it is the variable, else to 0
+    if (node->tt != Symbol) {
+      t.number = (node->tt == Identifier && node->t.identifier == var) ? 1 : 0;
+      push(&derivatives, newTreeNode(Number, t, NULL, NULL));
+      continue;
+    }
+    if (isCachedSize(sizes, i)) {
+      CacheEntry *e = lookup(cp, hashes[i], node, var);
+      if (e != NULL) {
+        cp->hits++;
+        unlinkEntry(cp, e);
+        linkNewest(cp, e);
+        long extra = e->cost - e->derivativeSize;
+        if (extra > 0) {
+          chargeBudget(extra, extra * sizeof(ExpTreeNode));
+        }
+        push(&derivatives, duplicate(e->derivative));
+        continue;
+      }
+      cp->misses++;
+      charged[i] = chargedNodes();
+    }
+    todo[top++] = -1 - i;
+    todo[top++] = i + 1 + sizes[i + 1];
+    todo[top++] = i + 1;
+  }
+  ExpTree result = pop(&derivatives);
+  freeStack(derivatives);
+  untrackScratch(nodes);
+  untrackScratch(hashes);
+  untrackScratch(sizes);
+  untrackScratch(charged);
+  untrackScratch(todo);
+  free(nodes);
+  free(hashes);
+  free(sizes);
+  free(charged);
+  free(todo);
+  INSTR_END(StageDifferentiate);
+  return result;
+}
+
+// Prints the hit, miss and eviction counters of the cache
+void printCacheStats(FILE *fp, DerivCache *cp) {
+  long lookups = cp->hits + cp->misses;
+  fprintf(fp, "derivative cache: %d/%d entries, %ld hits, %ld misses, %ld evictions, hit rate %.1f%%\n",
+          cp->count, cp->capacity, cp->hits, cp->misses, cp->evictions,
+          lookups == 0 ? 0.0 : 100.0 * cp->hits / lookups);
+}
+
+// Frees up the allocated space
+void freeDerivCache(DerivCache *cp) {
+  while (cp->oldest != NULL) {
+    evictOldest(cp);
+  }
+  free(cp->table);
+  cp->table = NULL;
+}
@@ -0,0 +1,44 @@
+#ifndef DERIVCACHE_H
+#define DERIVCACHE_H
+
+#include <stdio.h>
+#include "scanner.h"
+#include "prefixExp.h"
+
+// Only subtrees with a number of nodes in this range are cached, the whole expression also when
+// it is smaller. Smaller ones are cheaper to differentiate than to look up, and leaving out larger
+// ones keeps the copying linear in the size of the expression, a chain of n operators has n
+// nested subtrees
+#define DERIV_CACHE_MIN_NODES 7
+#define DERIV_CACHE_MAX_NODES 1024
+
+typedef struct CacheEntry {
+  unsigned long hash;
+  char *var;
+  ExpTree source;
+  ExpTree derivative;
+  int derivativeSize;
+  long cost;
+  struct CacheEntry *chain;
+  struct CacheEntry *newer;
+  struct CacheEntry *older;
+} CacheEntry;
+
+typedef struct DerivCache {
+  CacheEntry **table;
+  int tableSize;
+  CacheEntry *newest;
+  CacheEntry *oldest;
+  int count;
+  int capacity;
+  long hits;
+  long misses;
+  long evictions;
+} DerivCache;
+
+DerivCache newDerivCache(int capacity);
+ExpTree derivativeCached(DerivCache *cp, ExpTree tr, char *var);
+void printCacheStats(FILE *fp, DerivCache *cp);
+void freeDerivCache(DerivCache *cp);
+
+#endif
@@ -0,0 +1,248 @@
+/* file : flatExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Flat representation of expression trees. The nodes are stored in postorder in four parallel
+  arrays (kind, payload and 32 bit indices of the children) instead of separately allocated
+  nodes linked by pointers. A postorder walk is then a plain loop over the arrays, so evaluating
+  or hashing a tree reads memory front to back, and the arrays of a FlatTree are reused for tree
+  after tree. Trees are converted with flattenExpTree and expandFlatTree.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "batchExp.h"
+#include "symbolTable.h"
+#include "flatExp.h"
+#include "budgetExp.h"
+
+// Creates an empty flat tree, it grows with the largest tree stored in it
+FlatTree newFlatTree() {
+  FlatTree f;
+  f.kind = NULL;
+  f.payload = NULL;
+  f.left = NULL;
+  f.right = NULL;
+  f.count = 0;
+  f.size = 0;
+  return f;
+}
+
+// Makes room for n nodes
+static void reserveFlat(FlatTree *fp, int n) {
+  if (n <= fp->size) {
+    return;
+  }
+  fp->size = n > 2 * fp->size ? n : 2 * fp->size;
+  fp->kind = realloc(fp->kind, fp->size * sizeof(unsigned char));
+  fp->payload = realloc(fp->payload, fp->size * sizeof(Token));
+  fp->left = realloc(fp->left, fp->size * sizeof(int32_t));
+  fp->right = realloc(fp->right, fp->size * sizeof(int32_t));
+  assert(fp->kind != NULL && fp->payload != NULL && fp->left != NULL && fp->right != NULL);
+}
+
+// Replaces the contents of the flat tree by the nodes of tr and returns the number of nodes.
+// The nodes are visited with two stacks, like compileInto does
+int flattenExpTree(FlatTree *fp, ExpTree tr) {
+  fp->count = 0;
+  if (tr == NULL) {
+    return 0;
+  }
+  reserveFlat(fp, sizeExpTree(tr));
+  Stack visit = newStack(20);
+  Stack postorder = newStack(20);
+  push(&visit, tr);
+  while (!isEmptyStack(visit)) {
+    ExpTree node = pop(&visit);
+    push(&postorder, node);
+    if (node->tt == Symbol) {
+      push(&visit, node->left);
+      push(&visit, node->right);
+    }
+  }
+  //The indices of the finished subtrees wait on a stack until their parent is stored
+  int32_t *done = malloc(fp->size * sizeof(int32_t));
+  assert(done != NULL);
+  int top = 0;
+  while (!isEmptyStack(postorder)) {
+    ExpTree node = pop(&postorder);
+    int i = fp->count;
+    fp->kind[i] = node->tt;
+    fp->payload[i] = node->t;
+    if (node->tt == Symbol) {
+      fp->right[i] = done[top - 1];
+      fp->left[i] = done[top - 2];
+      top -= 2;
+    } else {
+      fp->left[i] = -1;
+      fp->right[i] = -1;
+    }
+    done[top] = i;
+    top++;
+    fp->count++;
+  }
+  free(done);
+  freeStack(visit);
+  freeStack(postorder);
+  return fp->count;
+}
+
+// Builds an ExpTree with the nodes of the flat tree, in the active arena if there is one.
+// Returns NULL for an empty flat tree
+ExpTree expandFlatTree(FlatTree *fp) {
+  if (fp->count == 0) {
+    return NULL;
+  }
+  ExpTree *nodes = malloc(fp->count * sizeof(ExpTree));
+  assert(nodes != NULL);
+  //Tracked, so it is not lost when making the nodes exceeds the budget
+  trackScratch(nodes, fp->count * sizeof(ExpTree));
+  //The children of a node are always made before the node itself
+  for (int i = 0; i < fp->count; i++) {
+    ExpTree tL = fp->left[i] < 0 ? NULL : nodes[fp->left[i]];
+    ExpTree tR = fp->right[i] < 0 ? NULL : nodes[fp->right[i]];
+    nodes[i] = newTreeNode(fp->kind[i], fp->payload[i], tL, tR);
+  }
+  ExpTree root = nodes[fp->count - 1];
+  untrackScratch(nodes);
+  free(nodes);
+  return root;
+}
+
+// Checks if the flat tree has no identifiers
+int isNumericalFlat(FlatTree *fp) {
+  for (int i = 0; i < fp->count; i++) {
+    if (fp->kind[i] == Identifier) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// Returns the value of the flat tree. The identifier with id k has the value vars[k], vars may
+// be NULL for a numerical tree. The operations are done in the same order as
+// valueExpTree does them, a division by zero gives inf or nan
+double valueFlatTree(FlatTree *fp, const double *vars) {
+  if (fp->count == 0) {
+    return 0;
+  }
+  double *values = malloc(fp->count * sizeof(double));
+  assert(values != NULL);
+  for (int i = 0; i < fp->count; i++) {
+    switch (fp->kind[i]) {
+      case Number:
+        values[i] = fp->payload[i].number;
+        break;
+      case Identifier:
+        values[i] = vars[identifierId(fp->payload[i].identifier)];
+        break;
+      default: {
+        double a = values[fp->left[i]], b = values[fp->right[i]];
+        switch (fp->payload[i].symbol) {
+          case '+':
+            values[i] = a + b;
+            break;
+          case '-':
+            values[i] = a - b;
+            break;
+          case '*':
+            values[i] = a * b;
+            break;
+          case '/':
+            values[i] = a / b;
+            break;
+          default:
+            abort();
+        }
+      }
+    }
+  }
+  double result = values[fp->count - 1];
+  free(values);
+  return result;
+}
+
+// Returns the same hash as hashExpTree gives for the tree, computed in a single loop
+unsigned long hashFlatTree(FlatTree *fp) {
+  if (fp->count == 0) {
+    return 0;
+  }
+  unsigned long *hashes = malloc(fp->count * sizeof(unsigned long));
+  assert(hashes != NULL);
+  for (int i = 0; i < fp->count; i++) {
+    ExpTreeNode node;
+    node.tt = fp->kind[i];
+    node.t = fp->payload[i];
+    node.left = NULL;
+    node.right = NULL;
+    unsigned long hL = fp->left[i] < 0 ? 0 : hashes[fp->left[i]];
+    unsigned long hR = fp->right[i] < 0 ? 0 : hashes[fp->right[i]];
+    hashes[i] = hashExpNode(&node, hL, hR);
+  }
+  unsigned long h = hashes[fp->count - 1];
+  free(hashes);
+  return h;
+}
+
+// Appends the infix form of the flat tree, in the same format as appendExpTreeInfix
+void appendFlatTreeInfix(OutBuffer *bp, FlatTree *fp) {
+  if (fp->count == 0) {
+    return;
+  }
+  //stage[k] tells how much of the node on position k of the stack is printed already
+  int32_t *stack = malloc(fp->count * sizeof(int32_t));
+  unsigned char *stage = malloc(fp->count);
+  assert(stack != NULL && stage != NULL);
+  int top = 0;
+  stack[top] = fp->count - 1;
+  stage[top] = 0;
+  top++;
+  while (top > 0) {
+    int i = stack[top - 1];
+    int next = -1;
+    if (fp->kind[i] == Number) {
+      appendLiteral(bp, fp->payload[i].number);
+      top--;
+    } else if (fp->kind[i] == Identifier) {
+      appendString(bp, fp->payload[i].identifier);
+      top--;
+    } else if (stage[top - 1] == 0) {
+      appendChar(bp, '(');
+      next = fp->left[i];
+      stage[top - 1] = 1;
+    } else if (stage[top - 1] == 1) {
+      appendChar(bp, ' ');
+      appendChar(bp, fp->payload[i].symbol);
+      appendChar(bp, ' ');
+      next = fp->right[i];
+      stage[top - 1] = 2;
+    } else {
+      appendChar(bp, ')');
+      top--;
+    }
+    if (next >= 0) {
+      stack[top] = next;
+      stage[top] = 0;
+      top++;
+    }
+  }
+  free(stack);
+  free(stage);
+}
+
+// Frees up the allocated space
+void freeFlatTree(FlatTree *fp) {
+  free(fp->kind);
+  free(fp->payload);
+  free(fp->left);
+  free(fp->right);
+  *fp = newFlatTree();
+}
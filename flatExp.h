@@ -0,0 +1,29 @@
+#ifndef FLATEXP_H
+#define FLATEXP_H
+
+#include <stdint.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "batchExp.h"
+
+// A tree as parallel arrays in postorder: the children of node i come before it, the root is the
+// last node. A leaf has -1 as children
+typedef struct FlatTree {
+  unsigned char *kind;
+  Token *payload;
+  int32_t *left;
+  int32_t *right;
+  int count;
+  int size;
+} FlatTree;
+
+FlatTree newFlatTree();
+int flattenExpTree(FlatTree *fp, ExpTree tr);
+ExpTree expandFlatTree(FlatTree *fp);
+int isNumericalFlat(FlatTree *fp);
+double valueFlatTree(FlatTree *fp, const double *vars);
+unsigned long hashFlatTree(FlatTree *fp);
+void appendFlatTreeInfix(OutBuffer *bp, FlatTree *fp);
+void freeFlatTree(FlatTree *fp);
+
+#endif
@@ -32,143 +32,321 @@
 #include "evalExp.h"
 #include "prefixExp.h"
 #include "infixExp.h"
+#include "arenaExp.h"
+#include "symbolTable.h"
+#include "instrumentExp.h"
+#include "budgetExp.h"
+#include "rewriteExp.h"
+#include "batchExp.h"
 
 // Function declaration
-Stack newStack(int s);
-void doubleStackSize(Stack *stp);
-void push(Stack *st, ExpTree x);
-int isEmptyStack(Stack st);
-void stackEmptyError();
-ExpTree pop(Stack *st);
-void freeStack(Stack st);
 int getPrecedence(char c);
 int checkInvalid(char c);
-ExpTree simplify(ExpTree t);
-void simplifyRec(ExpTree t);
 
-// Transforms the token list in an expression tree
+// The state of one parenthesis level of treeInfixExpr, its nodes are on the shared node stack from base on
+typedef struct ParseFrame {
+  int base;
+  int prio;
+  int currentPrio;
+} ParseFrame;
+
+// Pops a node of the current parenthesis level, it is an error if the level has no nodes left
+ExpTree popFrame(Stack *st, int base) {
+  if (st->top == base) {
+    stackEmptyError();
+  }
+  return pop(st);
+}
+
+// Transforms the token list in an expression tree. Parentheses are handled with an explicit
+// stack of levels instead of recursion, so the nesting depth is only limited by memory.
+// Reference implementation of the original second pass after acceptExpression, it is only kept
+// as the two-pass baseline of benchInfix.c. Expressions are parsed with parseInfixExpr
 int treeInfixExpr(List *lp, ExpTree *tp, int *paranthesis) {
   int checker = 1;
   double w;
   char *s;
   char c;
   Token t;
-  // We use a stack of nodes to handle the tree construction process
+  // We use a stack of nodes to handle the tree construction process, shared by all levels
   Stack stackNodes = newStack(20);
   ExpTree tempoTree;
-  int prio = -1, currentPrio = -1;
-  while (*lp != NULL) {
-    if ((*lp)->t.symbol == '(') {
+  int frameSize = 8, depth = 0;
+  ParseFrame *frames = malloc(frameSize * sizeof(ParseFrame));
+  assert(frames != NULL);
+  frames[0].base = 0;
+  frames[0].prio = -1;
+  frames[0].currentPrio = -1;
+  //resumed is set when the level just got the tree of a closed parenthesis
+  int resumed = 0;
+  while (1) {
+    ParseFrame *f = &frames[depth];
+    int ending = (*lp == NULL);
+    if (!ending && !resumed && (*lp)->tt == Symbol && (*lp)->t.symbol == '(') {
       //This keeps count of the number of paranthesis found, finding a right one icreases the counter while a left one decreases
       (*lp) = (*lp)->next;
       *paranthesis = *paranthesis + 1;
-      if (treeInfixExpr(lp, &tempoTree, paranthesis)) {
-        push(&stackNodes, tempoTree);
-        currentPrio = prio + 1;
-        if (*lp == NULL) {
-          break;
-        } 
-      } else {
-        freeStack(stackNodes);
-        return 0;
+      //A new level starts on top of the nodes of the current one
+      depth++;
+      if (depth == frameSize) {
+        frameSize = 2 * frameSize;
+        frames = realloc(frames, frameSize * sizeof(ParseFrame));
+        assert(frames != NULL);
       }
+      frames[depth].base = stackNodes.top;
+      frames[depth].prio = -1;
+      frames[depth].currentPrio = -1;
+      continue;
     }
-    if ((*lp)->t.symbol == ')') {
+    resumed = 0;
+
+    if (!ending && (*lp)->tt == Symbol && (*lp)->t.symbol == ')') {
       (*lp) = (*lp)->next;
       *paranthesis = *paranthesis - 1;
-      break;
+      ending = 1;
     }
 
-    if (valueOperator(lp, &c)) {
+    if (!ending && valueOperator(lp, &c)) {
       //Finding an operator immediately after another is considered bad input, thus incorrect input
-      if (valueOperator(lp, &c) || stackNodes.top == 0) {
+      if (valueOperator(lp, &c) || stackNodes.top == f->base) {
         checker = 0;
-        break;
-      }
-      t.symbol = c;
-      // Current priority is based in the precedence of the current character/operand
-      currentPrio = getPrecedence(c);
-      if (currentPrio > prio) {
-        //Current priority being higher pushes the symbol into the stack with the symbol at the top as its child
-        ExpTree newChild = newExpTreeNode(Symbol, t, pop(&stackNodes), NULL);
-        push(&stackNodes, newChild);
+        ending = 1;
       } else {
-        if (currentPrio == prio) {
-          //Equal priority case
-          tempoTree = pop(&stackNodes);
-          ExpTree fullTree = pop(&stackNodes);
-          fullTree->right = tempoTree;
-          ExpTree newChild = newExpTreeNode(Symbol, t, fullTree, NULL);
+        t.symbol = c;
+        // Current priority is based in the precedence of the current character/operand
+        f->currentPrio = getPrecedence(c);
+        if (f->currentPrio > f->prio) {
+          //Current priority being higher pushes the symbol into the stack with the symbol at the top as its child
+          ExpTree newChild = newTreeNode(Symbol, t, popFrame(&stackNodes, f->base), NULL);
           push(&stackNodes, newChild);
         } else {
-          //Current priority is lower case
-          ExpTree fullTree = pop(&stackNodes);
-          while(stackNodes.top!=0) {
-            tempoTree = pop(&stackNodes);
-            tempoTree->right = fullTree;
-            fullTree = tempoTree;
+          if (f->currentPrio == f->prio) {
+            //Equal priority case
+            tempoTree = popFrame(&stackNodes, f->base);
+            ExpTree fullTree = popFrame(&stackNodes, f->base);
+            fullTree->right = tempoTree;
+            ExpTree newChild = newTreeNode(Symbol, t, fullTree, NULL);
+            push(&stackNodes, newChild);
+          } else {
+            //Current priority is lower case
+            ExpTree fullTree = popFrame(&stackNodes, f->base);
+            while (stackNodes.top != f->base) {
+              tempoTree = pop(&stackNodes);
+              tempoTree->right = fullTree;
+              fullTree = tempoTree;
+            }
+            ExpTree newChild = newTreeNode(Symbol, t, fullTree, NULL);
+            push(&stackNodes, newChild);
           }
-          ExpTree newChild = newExpTreeNode(Symbol, t, fullTree, NULL);
-          push(&stackNodes, newChild);
-        }
-        if (*lp == NULL) {
-          //If the list empty after finding an operator, th input is wrong
-          ExpTree toRemove;
-          while (stackNodes.top > 0) {
-            toRemove = pop(&stackNodes);
-            freeExpTree(toRemove);
+          if (*lp == NULL) {
+            //If the list empty after finding an operator, th input is wrong
+            freeStack(stackNodes);
+            free(frames);
+            return 0;
           }
-          free(stackNodes.array);
-          return 0;
         }
       }
-
     }
 
-    prio = currentPrio;
+    if (!ending) {
+      f->prio = f->currentPrio;
 
-    //Finding a number pushes it into the stack
-    if (valueNumber(lp, &w)) {
-      t.number = w;
-      ExpTree newChild = newExpTreeNode(Number, t, NULL, NULL);
-      push(&stackNodes, newChild);
-    } else {
-      //Finding an identifier also pushes it into a stack
-      if (valueIdentifier(lp, &s)) {
-        t.identifier = s;
-        ExpTree newChild = newExpTreeNode(Identifier, t, NULL, NULL);
+      //Finding a number pushes it into the stack
+      if (valueNumber(lp, &w)) {
+        t.number = w;
+        ExpTree newChild = newTreeNode(Number, t, NULL, NULL);
         push(&stackNodes, newChild);
+      } else {
+        //Finding an identifier also pushes it into a stack
+        if (valueIdentifier(lp, &s)) {
+          t.identifier = s;
+          ExpTree newChild = newTreeNode(Identifier, t, NULL, NULL);
+          push(&stackNodes, newChild);
+        }
+      }
+
+      //Number followed by an identifer, without an operator in-between, is considered bad input
+      if (valueNumber(lp, &w) || valueIdentifier(lp, &s)) {
+        checker = 0;
+        ending = 1;
       }
     }
-    
-    //Number followed by an identifer, without an operator in-between, is considered bad input 
-    if (valueNumber(lp, &w) || valueIdentifier(lp, &s)) {
+
+    if (!ending) {
+      continue;
+    }
+
+    //The level ends: its stored elements are popped to build its tree
+    tempoTree = NULL;
+    if (stackNodes.top != f->base) {
+      tempoTree = pop(&stackNodes);
+      while (stackNodes.top > f->base) {
+        ExpTree parent = pop(&stackNodes);
+        parent->right = tempoTree;
+        tempoTree = parent;
+      }
+    }
+    //if the list is NULL and there are still paranthesis left, the input is considered wrong
+    if (*lp == NULL && *paranthesis != 0) {
       checker = 0;
-      break;
     }
+    if (depth == 0) {
+      if (tempoTree != NULL) {
+        *tp = tempoTree;
+      }
+      freeStack(stackNodes);
+      free(frames);
+      return checker;
+    }
+    //The tree of the parenthesis becomes an operand of the enclosing level
+    depth--;
+    if (!checker || tempoTree == NULL) {
+      releaseExpTree(tempoTree);
+      freeStack(stackNodes);
+      free(frames);
+      return 0;
+    }
+    push(&stackNodes, tempoTree);
+    frames[depth].currentPrio = frames[depth].prio + 1;
+    resumed = 1;
   }
+}
+
+// Builds the tree of the operator on top of the operator stack from the two top operands
+void reduceOperator(Stack *operands, Stack *operators) {
+  ExpTree op = pop(operators);
+  op->right = pop(operands);
+  op->left = pop(operands);
+  push(operands, op);
+}
 
-  //This uses the stack to build the tree
-  //by poping the stack's store elements
-  if (stackNodes.top != 0) {
-    tempoTree = pop(&stackNodes);
-    while (stackNodes.top > 0) {
-      *tp = pop(&stackNodes);
-      (*tp)->right = tempoTree;
-      tempoTree = *tp;
+// State of the single pass parser: operator nodes wait on a stack until both operands are
+// known, a NULL on that stack marks an open parenthesis
+typedef struct ParseState {
+  Stack operands;
+  Stack operators;
+  int expectOperand;
+  int error;
+} ParseState;
+
+static ParseState newParseState() {
+  ParseState ps;
+  ps.operands = newStack(20);
+  ps.operators = newStack(20);
+  //expectOperand tells if a number, identifier or '(' has to come next
+  ps.expectOperand = 1;
+  ps.error = 0;
+  return ps;
+}
+
+// Feeds one token to the parser, sets ps->error when the token cannot come here
+static void parseToken(ParseState *ps, TokenType tt, Token t) {
+  if (ps->expectOperand) {
+    if (tt == Number || tt == Identifier) {
+      push(&ps->operands, newTreeNode(tt, t, NULL, NULL));
+      ps->expectOperand = 0;
+    } else if (tt == Symbol && t.symbol == '(') {
+      push(&ps->operators, NULL);
+    } else {
+      ps->error = 1;
     }
+  } else if (tt == Symbol && isOperator(t.symbol)) {
+    //Operators of at least the same precedence are done first, so equal operators group to the left
+    int prio = getPrecedence(t.symbol);
+    while (!isEmptyStack(ps->operators) && ps->operators.array[ps->operators.top - 1] != NULL &&
+           getPrecedence(ps->operators.array[ps->operators.top - 1]->t.symbol) >= prio) {
+      reduceOperator(&ps->operands, &ps->operators);
+    }
+    push(&ps->operators, newTreeNode(Symbol, t, NULL, NULL));
+    ps->expectOperand = 1;
+  } else if (tt == Symbol && t.symbol == ')') {
+    while (!isEmptyStack(ps->operators) && ps->operators.array[ps->operators.top - 1] != NULL) {
+      reduceOperator(&ps->operands, &ps->operators);
+    }
+    if (isEmptyStack(ps->operators)) {
+      //There is no parenthesis to close
+      ps->error = 1;
+    } else {
+      pop(&ps->operators);
+    }
+  } else {
+    ps->error = 1;
+  }
+}
 
-    *tp = tempoTree;
+// Ends the parse after the last token. Returns 1 and sets *tp when all tokens formed one
+// expression, otherwise 0. The stacks of the state are freed
+static int finishParse(ParseState *ps, ExpTree *tp) {
+  //The tokens may only end after an operand and with all parentheses closed
+  while (!ps->error && !isEmptyStack(ps->operators)) {
+    if (ps->expectOperand || ps->operators.array[ps->operators.top - 1] == NULL) {
+      ps->error = 1;
+    } else {
+      reduceOperator(&ps->operands, &ps->operators);
+    }
+  }
+  int ok = !ps->error && !ps->expectOperand;
+  if (ok) {
+    *tp = pop(&ps->operands);
+  } else {
+    //Operator nodes are never linked into the operands before they are reduced
+    while (!isEmptyStack(ps->operators)) {
+      releaseNode(pop(&ps->operators));
+    }
   }
+  freeStack(ps->operands);
+  freeStack(ps->operators);
+  return ok;
+}
 
-  //if the list is NULL and there are still paranthesis left, the input is considered wrong
-  if (*lp == NULL && *paranthesis != 0) {
-    freeStack(stackNodes);
-    return 0;
+// Validates the token list and transforms it in an expression tree in a single pass, using
+// operator precedence parsing. The whole list must be one expression. Identifier nodes get the
+// interned name of the identifier (see symbolTable.c).
+// Returns 1 on success, otherwise 0 with *errorPos set to the index of the first wrong token
+// (the number of tokens if the list ends too early)
+int parseInfixExpr(List *lp, ExpTree *tp, int *errorPos) {
+  INSTR_BEGIN(StageParse);
+  ParseState ps = newParseState();
+  int position = 0;
+  while (*lp != NULL) {
+    Token t = (*lp)->t;
+    //The tree gets the interned name, the list keeps its own string
+    if ((*lp)->tt == Identifier) {
+      t.identifier = internIdentifier(t.identifier, strlen(t.identifier));
+    }
+    parseToken(&ps, (*lp)->tt, t);
+    if (ps.error) {
+      break;
+    }
+    *lp = (*lp)->next;
+    position++;
   }
+  int ok = finishParse(&ps, tp);
+  if (!ok) {
+    *errorPos = position;
+  }
+  INSTR_END(StageParse);
+  return ok;
+}
 
-  freeStack(stackNodes);
-  return checker;
+// Same as parseInfixExpr, for the n tokens of an array filled by scanTokens
+int parseTokenArray(ScanToken *tokens, int n, ExpTree *tp, int *errorPos) {
+  INSTR_BEGIN(StageParse);
+  ParseState ps = newParseState();
+  int position = 0;
+  while (position < n) {
+    parseToken(&ps, tokens[position].tt, tokens[position].t);
+    if (ps.error) {
+      break;
+    }
+    position++;
+  }
+  int ok = finishParse(&ps, tp);
+  if (!ok) {
+    *errorPos = position;
+  }
+  INSTR_END(StageParse);
+  return ok;
 }
 
 // Duplicates a given expression tree
@@ -177,139 +355,241 @@ ExpTree duplicate(ExpTree source) {
   if (source == NULL) {
     return source;
   }
-  // Recursive block
-  ExpTree newNode = newExpTreeNode((source)->tt, (source)->t, NULL, NULL);
-  //duplicates the left child
-  if ((source)->left != NULL) {
-    (newNode)->left = duplicate((source)->left);
-  }
-  //duplicates the right child
-  if ((source)->right != NULL) {
-    (newNode)->right = duplicate((source)->right);
+  // The nodes still to be copied and their copies are kept on two stacks
+  ExpTree newRoot = newTreeNode(source->tt, source->t, NULL, NULL);
+  Stack sources = newStack(20);
+  Stack copies = newStack(20);
+  push(&sources, source);
+  push(&copies, newRoot);
+  while (!isEmptyStack(sources)) {
+    ExpTree from = pop(&sources);
+    ExpTree to = pop(&copies);
+    //duplicates the left child
+    if (from->left != NULL) {
+      to->left = newTreeNode(from->left->tt, from->left->t, NULL, NULL);
+      push(&sources, from->left);
+      push(&copies, to->left);
+    }
+    //duplicates the right child
+    if (from->right != NULL) {
+      to->right = newTreeNode(from->right->tt, from->right->t, NULL, NULL);
+      push(&sources, from->right);
+      push(&copies, to->right);
+    }
   }
-  return newNode;
+  freeStack(sources);
+  freeStack(copies);
+  return newRoot;
 }
 
-// Differentiates the expression tree usign the rules provided in the assignment
+// Differentiates the expression tree to x, see differentiateTo
 void differentiate(ExpTree *root, int* differentVar) {
+  //Identifiers are interned, so x is recognized by its pointer. Every thread looks it up once
+  static _Thread_local char *x = NULL;
+  if (x == NULL) {
+    x = internIdentifier("x", 1);
+  }
+  differentiateTo(root, x, differentVar);
+}
+
+// Differentiates the expression tree to the interned identifier var usign the rules provided in
+// the assignment. *differentVar is set to 0 if var occurs in the tree.
+// Every rule changes the node it is applied to in place, so the nodes still to be
+// differentiated are kept on a stack instead of recursing
+void differentiateTo(ExpTree *root, char *var, int *differentVar) {
   // Base case block
   //This would mostly be irrelevant, but helps with incorrect input
   if ((*root) == NULL) {
     return;
   }
+  INSTR_BEGIN(StageDifferentiate);
+  Stack todo = newStack(20);
+  push(&todo, *root);
+  while (!isEmptyStack(todo)) {
+    ExpTree node = pop(&todo);
 
-  //This derivates a constant/non-identifier to x
-  if ((*root)->tt == Number) {
-    (*root)->t.number = 0;
-    return;
+    //This derivates a constant/non-identifier to var
+    if (node->tt == Number) {
+      node->t.number = 0;
+      continue;
+    }
+
+    //This handles the differentiation of an identifier
+    if (node->tt == Identifier) {
+      //If the identifier is different from var, it is differentiated to 0
+      if (node->t.identifier != var) {
+        node->tt = Number;
+        node->t.number = 0;
+      } else {
+        //If the identifier is var, it is differentiated to 1
+        node->tt = Number;
+        node->t.number = 1;
+        *differentVar = 0;
+      }
+      continue;
+    }
+
+    //This derivates using the addition and the subtraction rule
+    if (node->t.symbol == '+' || node->t.symbol == '-') {
+      push(&todo, node->left);
+      push(&todo, node->right);
+      continue;
+    }
+
+    ExpTree ch1 = node->left;
+    ExpTree ch2 = node->right;
+    Token multSym;
+    multSym.symbol = '*';
+    //In order to have both the differentiated version and the original, we must duplicate the elements
+    //of the initial multiplication and differentiate the copies
+    ExpTree p1 = duplicate(ch1);
+    ExpTree p2 = duplicate(ch2);
+    //These are the two multiplications that result from the derivation
+    //Having the expression (a*b)' the formula used is
+    //(a')*b + a*(b')
+    ExpTree multiplication1 = newTreeNode(Symbol, multSym, p1, ch2);
+    ExpTree multiplication2 = newTreeNode(Symbol, multSym, ch1, p2);
+
+    //This derivates using the multiplication rule
+    if (node->t.symbol == '*') {
+      node->t.symbol = '+';
+      node->left = multiplication1;
+      node->right = multiplication2;
+    } else if (node->t.symbol == '/') {
+      //Similar process to the multiplication, just with the added bonus of having the quotient keep the multiplications
+      Token tok;
+      tok.symbol = '-';
+      ExpTree quotient = newTreeNode(Symbol, tok, multiplication1, multiplication2);
+      //Since we need the original right element for the denominator, we duplicate it
+      ExpTree denominator = newTreeNode(Symbol, multSym, duplicate(ch2), duplicate(ch2));
+      //This completes the differentiation
+      node->left = quotient;
+      node->right = denominator;
+    }
+    push(&todo, p1);
+    push(&todo, p2);
+  }
+  freeStack(todo);
+  INSTR_END(StageDifferentiate);
+}
+
+// Returns the hash of the root of tr combined with the hashes of its children
+unsigned long hashExpNode(ExpTree tr, unsigned long hL, unsigned long hR) {
+  unsigned long h = 1469598103934665603UL;
+  unsigned long payload = 0;
+  if (tr->tt == Number) {
+    memcpy(&payload, &tr->t.number, sizeof(double));
+  } else if (tr->tt == Identifier) {
+    payload = identifierId(tr->t.identifier);
+  } else {
+    payload = (unsigned char)tr->t.symbol;
   }
+  h = (h ^ tr->tt) * 1099511628211UL;
+  h = (h ^ payload) * 1099511628211UL;
+  h = (h ^ hL) * 1099511628211UL;
+  h = (h ^ hR) * 1099511628211UL;
+  return h ^ (h >> 29);
+}
 
-  //This handles the differentiation of an identifier
-  if ((*root)->tt == Identifier) {
-    //If the identifier is different from x, it is differentiated to 0
-    if (strcmp((*root)->t.identifier, "x") != 0) {
-      (*root)->tt = Number;
-      (*root)->t.number = 0;
-    } else {
-      //If the identifier is x, it is differentiated to 1
-      (*root)->tt = Number;
-      (*root)->t.number = 1;
-      *differentVar = 0;
+// Returns a hash of the structure of the tree, equal trees get equal hashes. The nodes are
+// visited in postorder using two stacks, the hashes of the children are kept in an array
+unsigned long hashExpTree(ExpTree tr) {
+  if (tr == NULL) {
+    return 0;
+  }
+  Stack visit = newStack(20);
+  Stack postorder = newStack(20);
+  push(&visit, tr);
+  while (!isEmptyStack(visit)) {
+    ExpTree node = pop(&visit);
+    push(&postorder, node);
+    if (node->left != NULL) {
+      push(&visit, node->left);
+    }
+    if (node->right != NULL) {
+      push(&visit, node->right);
     }
-    return;
   }
+  //There are never more hashes waiting than there are nodes
+  unsigned long *hashes = malloc(postorder.top * sizeof(unsigned long));
+  assert(hashes != NULL);
+  int count = 0;
+  while (!isEmptyStack(postorder)) {
+    ExpTree node = pop(&postorder);
+    unsigned long hR = node->right == NULL ? 0 : hashes[--count];
+    unsigned long hL = node->left == NULL ? 0 : hashes[--count];
+    hashes[count++] = hashExpNode(node, hL, hR);
+  }
+  unsigned long h = hashes[0];
+  free(hashes);
+  freeStack(visit);
+  freeStack(postorder);
+  return h;
+}
 
-  // Recursive block
-  if ((*root)->tt == Symbol) {
-    //This derivates using the addition rule
-    if ((*root)->t.symbol == '+') {
-      differentiate(&(*root)->left, differentVar);
-      differentiate(&(*root)->right, differentVar);
-      return;
-    } else {
-      //This derivates using the subtraction rule
-      if ((*root)->t.symbol == '-') {
-        differentiate(&(*root)->left, differentVar);
-        differentiate(&(*root)->right,differentVar);
-      } else {
-        //This derivates using the multiplication rule
-        if ((*root)->t.symbol == '*') {
-          (*root)->t.symbol = '+';
-          ExpTree ch1 = (*root)->left;
-          ExpTree ch2 = (*root)->right;
-
-
-          Token tok;
-          tok.symbol = '*';
-          //These are the two multiplications that result from the derivation
-          ExpTree multiplication1 = newExpTreeNode(Symbol, tok, NULL, NULL);
-          ExpTree multiplication2 = newExpTreeNode(Symbol, tok, NULL, NULL);
-          (*root)->left = multiplication1;
-          (*root)->right = multiplication2;
-          //In order to have both the differentiated version and the original, we must duplicate the elements 
-          //of the initial multiplication and differentiate the copies
-          ExpTree p1 = duplicate(ch1);
-          differentiate(&p1, differentVar);
-          ExpTree p2 = duplicate(ch2);
-          differentiate(&p2, differentVar);
-          //Having the expression (a*b)' the formula used is
-          //(a')*b + a*(b')
-          (multiplication1)->left = p1;
-          (multiplication1)->right = ch2;
-          (multiplication2)->left = ch1;
-          (multiplication2)->right = p2;
-          return;
-        } else {
-          if ((*root)->t.symbol == '/') {
-          ExpTree ch1 = (*root)->left;
-          ExpTree ch2 = (*root)->right;
-
-          //Will be used for the subtraction of the quotient
-          Token tok;
-          tok.symbol = '-';
-          
-          //Will be used for the multiplications
-          Token multSym;
-          multSym.symbol = '*';
-          //These are all the relevant nodes, the quotient and its multiplications and the denominator
-          ExpTree quotient = newExpTreeNode(Symbol, tok, NULL, NULL);
-          ExpTree multiplication1 = newExpTreeNode(Symbol, multSym, NULL, NULL);
-          ExpTree multiplication2 = newExpTreeNode(Symbol, multSym, NULL, NULL);
-          ExpTree denominator = newExpTreeNode(Symbol, multSym, NULL, NULL);
-
-          //Similar process to the multiplication, just with the added bonus of having the quotient keep the multiplications
-          ExpTree p1 = duplicate(ch1);
-          differentiate(&p1, differentVar);
-          ExpTree p2 = duplicate(ch2);
-          differentiate(&p2, differentVar);
-          //Having the expression (a*b)' the formula used is
-          //(a')*b + a*(b')
-          (multiplication1)->left = p1;
-          (multiplication1)->right = ch2;
-          (multiplication2)->left = ch1;
-          (multiplication2)->right = p2;
-
-          (quotient)->left = multiplication1;
-          (quotient)->right = multiplication2;
-
-          //Since we need the original right element for the denominator, we duplicate it
-          ExpTree p3 = duplicate(ch2);
-          ExpTree p4 = duplicate(ch2);
-          (denominator)->left = p3;
-          (denominator)->right = p4;
-          
-          //This completes the differentiation
-          (*root)->left = quotient;
-          (*root)->right = denominator;
-         
-          return;
-          }
-        }
-      }
-      
+// Returns the number of nodes of the tree
+int sizeExpTree(ExpTree tr) {
+  if (tr == NULL) {
+    return 0;
+  }
+  int size = 0;
+  Stack st = newStack(20);
+  push(&st, tr);
+  while (!isEmptyStack(st)) {
+    ExpTree node = pop(&st);
+    size++;
+    if (node->left != NULL) {
+      push(&st, node->left);
+    }
+    if (node->right != NULL) {
+      push(&st, node->right);
     }
   }
-  return;
+  freeStack(st);
+  return size;
+}
+
+// Checks if two trees have the same structure and the same numbers, identifiers and operators.
+// Identifiers are interned, so they are compared by pointer
+int equalExpTree(ExpTree a, ExpTree b) {
+  int equal = 1;
+  // The pairs of subtrees still to be compared are kept on two stacks
+  Stack as = newStack(20);
+  Stack bs = newStack(20);
+  push(&as, a);
+  push(&bs, b);
+  while (equal && !isEmptyStack(as)) {
+    a = pop(&as);
+    b = pop(&bs);
+    if (a == b) {
+      continue;
+    }
+    if (a == NULL || b == NULL || a->tt != b->tt) {
+      equal = 0;
+      continue;
+    }
+    switch (a->tt) {
+      case Number:
+        equal = memcmp(&a->t.number, &b->t.number, sizeof(double)) == 0;
+        break;
+      case Identifier:
+        equal = a->t.identifier == b->t.identifier;
+        break;
+      case Symbol:
+        equal = a->t.symbol == b->t.symbol;
+        push(&as, a->left);
+        push(&bs, b->left);
+        push(&as, a->right);
+        push(&bs, b->right);
+        break;
+    }
+  }
+  //The stacks only hold nodes of the compared trees, they must not be released
+  as.top = 0;
+  bs.top = 0;
+  freeStack(as);
+  freeStack(bs);
+  return equal;
 }
 
 // Gets the user input and calls the corresponding functions
@@ -318,21 +598,27 @@ void infixExpTrees() {
   int differingVariable = 1;
   List tl, tl1;
   ExpTree t = NULL;
+  // All nodes of one expression are taken from this arena and released together
+  NodeArena arena = newArena();
+  useArena(&arena);
   printf("give an expression: ");
   ar = readInput();
   while (ar[0] != '!') {
     differingVariable = 1;
     // Transforms the user input into a token list
+    INSTR_BEGIN(StageScan);
     tl = tokenList(ar);
+    INSTR_END(StageScan);
     // Prints out the token list (initial user input)
     printList(tl);
     tl1 = tl;
-    List tl2 = tl;
-    int paranthesis = 0;
-    if ((acceptExpression(&tl2) && tl2 == NULL) && tl != NULL && treeInfixExpr(&tl1, &t, &paranthesis) && tl1 == NULL) {
+    int errorPos = 0;
+    // Validates the token list and builds its tree in one pass
+    if (parseInfixExpr(&tl1, &t, &errorPos)) {
+      INSTR_TREE_SIZE(t);
       printf("in infix notation: ");
       // Prints out the infix form of the expresion
-      printExpTreeInfix(t);
+      writeExpTreeInfix(stdout, t);
       printf("\n");
       if (isNumerical(t)) {
         printf("the value is %g\n",valueExpTree(t));
@@ -341,20 +627,22 @@ void infixExpTrees() {
         // 't' holds the simplified expression tree
         t = simplify(t);
         printf("simplified: ");
-        printExpTreeInfix(t);
+        writeExpTreeInfix(stdout, t);
         printf("\n");
         // The expression tree 't' gets differentiated
         differentiate(&t, &differingVariable);
         printf("derivative to x: ");
         // The expression tree gets simplified once more and is printed out
         t = simplify(t);
-        printExpTreeInfix(t);
+        INSTR_TREE_SIZE(t);
+        writeExpTreeInfix(stdout, t);
       }
     } else {
-      printf("this is not an expression\n");
+      // errorPos is the index of the first wrong token, as in the error records of the batch mode
+      printf("this is not an expression, error at token %d\n", errorPos);
     }
     // Freeing up the memory
-    freeExpTree(t);
+    resetArena(&arena);
     t = NULL;
     freeTokenList(tl);
     free(ar);
@@ -362,25 +650,46 @@ void infixExpTrees() {
     ar = readInput();
   }
   free(ar);
+  useArena(NULL);
+  freeArena(&arena);
+  freeSpareStacks();
   printf("good bye\n");
 }
 
+// Arrays of freed stacks are kept here, so parsing a stream of expressions does not
+// malloc a new stack for every expression and every parenthesis. Every thread keeps its own
+#define SPARE_STACKS 8
+static _Thread_local Stack spareStacks[SPARE_STACKS];
+static _Thread_local int spareCount = 0;
+
 // Creates an empty stack of size s
 Stack newStack(int s) {
   Stack st;
+  //A kept array is reused when it is large enough
+  if (spareCount > 0 && spareStacks[spareCount - 1].size >= s) {
+    spareCount--;
+    st = spareStacks[spareCount];
+    st.top = 0;
+    trackScratch(st.array, st.size * sizeof(ExpTree));
+    return st;
+  }
   st.array = malloc(s*sizeof(ExpTree));
   assert(st.array != NULL);
   st.top = 0;
   st.size = s;
+  trackScratch(st.array, s * sizeof(ExpTree));
   return st;
 }
 
 // Doubles the stack size
 void doubleStackSize(Stack *stp) {
+  INSTR_COUNT(stackGrowths);
   int newSize = 2 * stp->size;
+  untrackScratch(stp->array);
   stp->array = realloc(stp->array, newSize * sizeof(*stp->array));
   assert(stp->array != NULL);
   stp->size = newSize;
+  trackScratch(stp->array, newSize * sizeof(*stp->array));
   return;
 }
 
@@ -419,9 +728,23 @@ ExpTree pop(Stack *st) {
 void freeStack(Stack st) {
   while (st.top > 0) {
     ExpTree toFree = pop(&st);
-    freeExpTree(toFree);
+    releaseExpTree(toFree);
+  }
+  untrackScratch(st.array);
+  if (spareCount < SPARE_STACKS) {
+    spareStacks[spareCount] = st;
+    spareCount++;
+  } else {
+    free(st.array);
+  }
+}
+
+// Frees the arrays this thread kept for reuse by newStack
+void freeSpareStacks() {
+  while (spareCount > 0) {
+    spareCount--;
+    free(spareStacks[spareCount].array);
   }
-  free(st.array);
 }
 
 // Returns the precedence of the operator
@@ -447,21 +770,46 @@ int checkInvalid(char c) {
   return 0;
 }
 
-// Returns the simplified tree
+// Returns the simplified tree, the rules of rewriteExp.c are applied until none matches
 ExpTree simplify(ExpTree t) {
-  simplifyRec(t);
+  INSTR_BEGIN(StageSimplify);
+  t = simplifyFixpoint(t);
+  INSTR_END(StageSimplify);
   return t;
 }
 
-// Recursively simplifies an expression of the expression tree t
+// Single pass simplifier, only removes identity elements. Simplifies an expression of the
+// expression tree t bottom-up, the nodes are visited in postorder using two stacks.
+// Reference implementation of the original simplifier, it is only kept as the single pass
+// baseline of benchInfix.c. Expressions are simplified with simplify
 void simplifyRec(ExpTree t) {
   // Base case
   if (t == NULL) {
     return;
   }
-  // Recursive block
-  simplifyRec(t->left);
-  simplifyRec(t->right);
+  Stack visit = newStack(20);
+  Stack postorder = newStack(20);
+  push(&visit, t);
+  while (!isEmptyStack(visit)) {
+    ExpTree node = pop(&visit);
+    push(&postorder, node);
+    if (node->tt == Symbol) {
+      push(&visit, node->left);
+      push(&visit, node->right);
+    }
+  }
+  //Children come off the stack before their parents
+  while (!isEmptyStack(postorder)) {
+    simplifyNode(pop(&postorder));
+  }
+  freeStack(visit);
+  freeStack(postorder);
+}
+
+// Simplifies the root of t, its children must be simplified already. A child that takes the place
+// of t passes its interned identifier on by pointer, which is safe because interned names are never freed.
+// Part of the reference simplifier simplifyRec
+void simplifyNode(ExpTree t) {
   // Simplifying the expression
   if (t->tt == Symbol && (t->t.symbol == '*' || t->t.symbol == '/' || t->t.symbol == '+' || t->t.symbol == '-')) {
     if (t->t.symbol == '*') {
@@ -470,8 +818,8 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 1) {
           t->tt = Number;
           t->t.number = t->left->t.number;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -479,8 +827,8 @@ void simplifyRec(ExpTree t) {
         else if (t->right->t.number == 0) {
           t->tt = Number;
           t->t.number = 0;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -488,8 +836,8 @@ void simplifyRec(ExpTree t) {
         else if (t->left->t.number == 1) {
           t->tt = Number;
           t->t.number = t->right->t.number;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -497,8 +845,8 @@ void simplifyRec(ExpTree t) {
         else if (t->left->t.number == 0) {
           t->tt = Number;
           t->t.number = 0;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -508,8 +856,8 @@ void simplifyRec(ExpTree t) {
         if (t->left->t.number == 1) {
           t->tt = Identifier;
           t->t.identifier = t->right->t.identifier;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -517,8 +865,8 @@ void simplifyRec(ExpTree t) {
         else if (t->left->t.number == 0) {
           t->tt = Number;
           t->t.number = 0;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -528,19 +876,19 @@ void simplifyRec(ExpTree t) {
         if (t->left->t.number == 1) {
           t->tt = Symbol;
           t->t.symbol = t->right->t.symbol;
-          free(t->left);
+          releaseNode(t->left);
           t->left = NULL;
           ExpTree newNode = t->right;
           t->left = newNode->left;
           t->right = newNode->right;
-          free(newNode); 
+          releaseNode(newNode); 
         }
         // Recognizes and simplifies 0 * exp
         else if (t->left->t.number == 0) {
           t->tt = Number;
           t->t.number = 0;
-          free(t->left);
-          freeExpTree(t->right);
+          releaseNode(t->left);
+          releaseExpTree(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -550,8 +898,8 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 1) {
           t->tt = Identifier;
           t->t.identifier = t->left->t.identifier;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -559,8 +907,8 @@ void simplifyRec(ExpTree t) {
         else if (t->right->t.number == 0) {
           t->tt = Number;
           t->t.number = 0;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -570,19 +918,19 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 1) {
           t->tt = Symbol;
           t->t.symbol = t->left->t.symbol;
-          free(t->right);
+          releaseNode(t->right);
           t->right = NULL;
           ExpTree newNode = t->left;
           t->left = newNode->left;
           t->right = newNode->right;
-          free(newNode);      
+          releaseNode(newNode);      
         }
         // Recognizes and simplifies exp * 0
         else if (t->right->t.number == 0) {
           t->tt = Number;
           t->t.number = 0;
-          freeExpTree(t->left);
-          free(t->right);
+          releaseExpTree(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -594,8 +942,8 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 1) {
           t->tt = Number;
           t->t.number = t->left->t.number;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -605,8 +953,8 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 1) {
           t->tt = Identifier;
           t->t.identifier = t->left->t.identifier;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -616,12 +964,12 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 1) {
           t->tt = Symbol;
           t->t.symbol = t->left->t.symbol;
-          free(t->right);
+          releaseNode(t->right);
           t->right = NULL;
           ExpTree newNode = t->left;
           t->left = newNode->left;
           t->right = newNode->right;
-          free(newNode);
+          releaseNode(newNode);
         }
       }
     }
@@ -631,8 +979,8 @@ void simplifyRec(ExpTree t) {
           // Recognizes and simplifies 0 + n
           t->tt = Number;
           t->t.number = t->right->t.number;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -640,8 +988,8 @@ void simplifyRec(ExpTree t) {
           // Recognizes and simplifies n + 0
           t->tt = Number;
           t->t.number = t->left->t.number;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -651,8 +999,8 @@ void simplifyRec(ExpTree t) {
         if (t->left->t.number == 0) {
           t->tt = Identifier;
           t->t.identifier = t->right->t.identifier;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -662,8 +1010,8 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 0) {
           t->tt = Identifier;
           t->t.identifier = t->left->t.identifier;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -673,12 +1021,12 @@ void simplifyRec(ExpTree t) {
         if (t->left->t.number == 0) {
           t->tt = Symbol;
           t->t.symbol = t->right->t.symbol;
-          free(t->left);
+          releaseNode(t->left);
           t->left = NULL;
           ExpTree newNode = t->right;
           t->left = newNode->left;
           t->right = newNode->right;
-          free(newNode);
+          releaseNode(newNode);
         }
       }
       else if (t->left->tt == Symbol && t->right->tt == Number) {
@@ -686,12 +1034,12 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 0) {
           t->tt = Symbol;
           t->t.symbol = t->left->t.symbol;
-          free(t->right);
+          releaseNode(t->right);
           t->right = NULL;
           ExpTree newNode = t->left;
           t->left = newNode->left;
           t->right = newNode->right;
-          free(newNode);
+          releaseNode(newNode);
         }
       }
     }
@@ -701,8 +1049,8 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 0) {
           t->tt = Number;
           t->t.number = t->left->t.number;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -712,8 +1060,8 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 0) {
           t->tt = Identifier;
           t->t.identifier = t->left->t.identifier;
-          free(t->left);
-          free(t->right);
+          releaseNode(t->left);
+          releaseNode(t->right);
           t->left = NULL;
           t->right = NULL;
         }
@@ -723,12 +1071,12 @@ void simplifyRec(ExpTree t) {
         if (t->right->t.number == 0) {
           t->tt = Symbol;
           t->t.symbol = t->left->t.symbol;
-          free(t->right);
+          releaseNode(t->right);
           t->right = NULL;
           ExpTree newNode = t->left;
           t->left = newNode->left;
           t->right = newNode->right;
-          free(newNode);
+          releaseNode(newNode);
         }
       }
     }
@@ -3,16 +3,30 @@
 
 #include "scanner.h"
 #include "prefixExp.h"
+#include "scanExp.h"
 
 ExpTree newExpTreeNode(TokenType tt, Token t, ExpTree tL, ExpTree tR);
 int valueIdentifier(List *lp, char **sp);
 int isNumerical(ExpTree tr);
 double valueExpTree(ExpTree tr);
+// Reference implementation, only used as a baseline by benchInfix.c
 int treeInfixExpr(List *lp, ExpTree *tp, int *parenthesis);
+int parseInfixExpr(List *lp, ExpTree *tp, int *errorPos);
+int parseTokenArray(ScanToken *tokens, int n, ExpTree *tp, int *errorPos);
 void printExpTreeInfix(ExpTree tr);
 void infixExpTrees();
 ExpTree duplicate(ExpTree source);
 void differentiate(ExpTree *root, int* differingVar);
+void differentiateTo(ExpTree *root, char *var, int *differingVar);
+ExpTree simplify(ExpTree t);
+// Reference implementation, only used as a baseline by benchInfix.c
+void simplifyRec(ExpTree t);
+void simplifyNode(ExpTree t);
+unsigned long hashExpNode(ExpTree tr, unsigned long hL, unsigned long hR);
+unsigned long hashExpTree(ExpTree tr);
+int equalExpTree(ExpTree a, ExpTree b);
+int sizeExpTree(ExpTree tr);
+void freeSpareStacks();
 
 typedef struct Stack {
   ExpTree *array;
@@ -20,4 +34,12 @@ typedef struct Stack {
   int size;
 } Stack;
 
+Stack newStack(int s);
+void doubleStackSize(Stack *stp);
+void push(Stack *st, ExpTree x);
+int isEmptyStack(Stack st);
+void stackEmptyError();
+ExpTree pop(Stack *st);
+void freeStack(Stack st);
+
 #endif
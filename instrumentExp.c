@@ -0,0 +1,112 @@
+/* file : instrumentExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Counters of the instrumented build (compiled with -DINFIX_INSTRUMENT, see instrumentExp.h).
+  Per stage the time is counted in clock ticks (the time stamp counter on x86, nanoseconds
+  elsewhere) together with the number of calls. Further the tree nodes allocated and freed, the
+  stack growths in doubleStackSize and the largest tree seen are counted. Every thread counts in
+  its own counters, mergeInstrumentation adds them to the totals that printInstrumentation shows
+  together with the rule counts of the simplifier. Without INFIX_INSTRUMENT this file is empty.
+*/
+
+#ifdef INFIX_INSTRUMENT
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "rewriteExp.h"
+#include "instrumentExp.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TICK_UNIT "cycles"
+#else
+#define TICK_UNIT "ns"
+#endif
+
+_Thread_local InstrumentCounters instrumentLocal;
+static InstrumentCounters instrumentTotal;
+static pthread_mutex_t instrumentLock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *stageNames[STAGE_COUNT] = {
+  "scan", "parse", "simplify", "differentiate", "print", "evaluate"
+};
+
+// Returns the current clock tick
+unsigned long long instrumentClock() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+// Counts a call of a stage that took ticks clock ticks
+void instrumentStage(InstrumentStage stage, unsigned long long ticks) {
+  instrumentLocal.ticks[stage] += ticks;
+  instrumentLocal.calls[stage]++;
+}
+
+// Remembers the size of the largest tree
+void instrumentTreeSize(long size) {
+  if (size > instrumentLocal.peakTreeSize) {
+    instrumentLocal.peakTreeSize = size;
+  }
+}
+
+// Adds the counters of this thread to the totals and clears them
+void mergeInstrumentation() {
+  pthread_mutex_lock(&instrumentLock);
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    instrumentTotal.ticks[s] += instrumentLocal.ticks[s];
+    instrumentTotal.calls[s] += instrumentLocal.calls[s];
+  }
+  instrumentTotal.nodeAllocs += instrumentLocal.nodeAllocs;
+  instrumentTotal.nodeFrees += instrumentLocal.nodeFrees;
+  instrumentTotal.stackGrowths += instrumentLocal.stackGrowths;
+  if (instrumentLocal.peakTreeSize > instrumentTotal.peakTreeSize) {
+    instrumentTotal.peakTreeSize = instrumentLocal.peakTreeSize;
+  }
+  pthread_mutex_unlock(&instrumentLock);
+  memset(&instrumentLocal, 0, sizeof(InstrumentCounters));
+}
+
+// Merges the counters of the calling thread and prints the totals so far
+void printInstrumentation(FILE *fp) {
+  mergeInstrumentation();
+  mergeRewriteStats();
+  pthread_mutex_lock(&instrumentLock);
+  for (int s = 0; s < STAGE_COUNT; s++) {
+    long calls = instrumentTotal.calls[s];
+    fprintf(fp, "stage %-14s %10ld calls %16llu %s %12.1f %s/call\n", stageNames[s], calls,
+            instrumentTotal.ticks[s], TICK_UNIT,
+            calls == 0 ? 0.0 : (double)instrumentTotal.ticks[s] / calls, TICK_UNIT);
+  }
+  fprintf(fp, "nodes %ld allocated, %ld freed\n", instrumentTotal.nodeAllocs, instrumentTotal.nodeFrees);
+  fprintf(fp, "largest tree %ld nodes\n", instrumentTotal.peakTreeSize);
+  fprintf(fp, "stack growths %ld\n", instrumentTotal.stackGrowths);
+  pthread_mutex_unlock(&instrumentLock);
+  printRewriteStats(fp);
+}
+
+static void printAtExit() {
+  printInstrumentation(stderr);
+}
+
+// Prints the totals on stderr when the program ends
+void printInstrumentationAtExit() {
+  atexit(printAtExit);
+}
+
+#else
+
+// ISO C does not allow an empty translation unit
+typedef int instrumentDisabled;
+
+#endif
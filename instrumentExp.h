@@ -0,0 +1,61 @@
+#ifndef INSTRUMENTEXP_H
+#define INSTRUMENTEXP_H
+
+#include <stdio.h>
+
+// Instrumentation of the hot paths, only compiled in with -DINFIX_INSTRUMENT. Without it every
+// INSTR_ macro expands to nothing and its arguments are not evaluated
+
+typedef enum InstrumentStage {
+  StageScan,
+  StageParse,
+  StageSimplify,
+  StageDifferentiate,
+  StagePrint,
+  StageEvaluate,
+  STAGE_COUNT
+} InstrumentStage;
+
+#ifdef INFIX_INSTRUMENT
+
+typedef struct InstrumentCounters {
+  unsigned long long ticks[STAGE_COUNT];
+  long calls[STAGE_COUNT];
+  long nodeAllocs;
+  long nodeFrees;
+  long stackGrowths;
+  long peakTreeSize;
+} InstrumentCounters;
+
+extern _Thread_local InstrumentCounters instrumentLocal;
+
+unsigned long long instrumentClock();
+void instrumentStage(InstrumentStage stage, unsigned long long ticks);
+void instrumentTreeSize(long size);
+void mergeInstrumentation();
+void printInstrumentation(FILE *fp);
+void printInstrumentationAtExit();
+
+#define INSTR_BEGIN(stage) unsigned long long instrStart_##stage = instrumentClock()
+#define INSTR_END(stage) instrumentStage(stage, instrumentClock() - instrStart_##stage)
+#define INSTR_COUNT(counter) (instrumentLocal.counter++)
+#define INSTR_ADD(counter, n) (instrumentLocal.counter += (n))
+#define INSTR_TREE_SIZE(tr) instrumentTreeSize(sizeExpTree(tr))
+#define INSTR_MERGE() mergeInstrumentation()
+#define INSTR_DUMP(fp) printInstrumentation(fp)
+#define INSTR_DUMP_AT_EXIT() printInstrumentationAtExit()
+
+#else
+
+#define INSTR_BEGIN(stage)
+#define INSTR_END(stage)
+#define INSTR_COUNT(counter)
+#define INSTR_ADD(counter, n)
+#define INSTR_TREE_SIZE(tr)
+#define INSTR_MERGE()
+#define INSTR_DUMP(fp)
+#define INSTR_DUMP_AT_EXIT()
+
+#endif
+
+#endif
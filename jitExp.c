@@ -0,0 +1,260 @@
+/* file : jitExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Compiles an expression tree, normally the output of simplify, to x86-64 machine code of the
+  form double f(const double *vars). The tree is first compiled to bytecode (see bytecodeExp.c)
+  and every instruction becomes one or two SSE2 instructions: stack entry k of the bytecode is
+  kept in register xmm<k>, entries from JIT_REGISTERS on live in the stack frame and xmm14 is
+  used as scratch. Numbers are loaded as immediates, identifiers from vars at the offset of
+  their slot, which is resolved at compile time. The code is written to an mmap'd buffer that
+  is made executable (and no longer writable) before it is run.
+  The operations are the same scalar double operations in the same order as runProgram does,
+  so the results are bit-identical. On other machines, when mmap fails or when built with
+  -DINFIX_NO_JIT, runJit falls back to runProgram. testInfix.c checks both against runProgram.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <stdint.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "bytecodeExp.h"
+#include "instrumentExp.h"
+#include "jitExp.h"
+
+#if defined(__x86_64__) && defined(__unix__) && !defined(INFIX_NO_JIT)
+#define JIT_NATIVE 1
+#include <sys/mman.h>
+#else
+#define JIT_NATIVE 0
+#endif
+
+#if JIT_NATIVE
+
+// Most bytes of machine code a single bytecode instruction becomes
+#define JIT_INSTRUCTION_BYTES 32
+// The scratch register and the numbers of the base registers
+#define SCRATCH 14
+#define RSP 4
+#define RDI 7
+
+// Opcodes of the scalar double instructions, all with the prefix F2 0F
+#define MOVSD_LOAD 0x10
+#define MOVSD_STORE 0x11
+#define ADDSD 0x58
+#define MULSD 0x59
+#define SUBSD 0x5C
+#define DIVSD 0x5E
+
+typedef struct CodeBuffer {
+  unsigned char *bytes;
+  size_t length;
+} CodeBuffer;
+
+static void emitByte(CodeBuffer *cp, unsigned char b) {
+  cp->bytes[cp->length] = b;
+  cp->length++;
+}
+
+static void emitWord(CodeBuffer *cp, uint32_t w) {
+  for (int i = 0; i < 4; i++) {
+    emitByte(cp, (w >> (8 * i)) & 0xFF);
+  }
+}
+
+// Emits op xmm<dst>, xmm<src>
+static void emitRegReg(CodeBuffer *cp, unsigned char op, int dst, int src) {
+  emitByte(cp, 0xF2);
+  if (dst >= 8 || src >= 8) {
+    emitByte(cp, 0x40 | ((dst >> 3) << 2) | (src >> 3));
+  }
+  emitByte(cp, 0x0F);
+  emitByte(cp, op);
+  emitByte(cp, 0xC0 | ((dst & 7) << 3) | (src & 7));
+}
+
+// Emits op xmm<reg>, [base + offset], or the store movsd [base + offset], xmm<reg>
+static void emitRegMem(CodeBuffer *cp, unsigned char op, int reg, int base, int offset) {
+  emitByte(cp, 0xF2);
+  if (reg >= 8) {
+    emitByte(cp, 0x44);
+  }
+  emitByte(cp, 0x0F);
+  emitByte(cp, op);
+  emitByte(cp, 0x80 | ((reg & 7) << 3) | base);
+  if (base == RSP) {
+    emitByte(cp, 0x24);
+  }
+  emitWord(cp, (uint32_t)offset);
+}
+
+// Emits mov rax, <bits of number>; movq xmm<reg>, rax
+static void emitConstant(CodeBuffer *cp, int reg, double number) {
+  uint64_t bits;
+  memcpy(&bits, &number, sizeof(bits));
+  emitByte(cp, 0x48);
+  emitByte(cp, 0xB8);
+  emitWord(cp, (uint32_t)bits);
+  emitWord(cp, (uint32_t)(bits >> 32));
+  emitByte(cp, 0x66);
+  emitByte(cp, 0x48 | ((reg >> 3) << 2));
+  emitByte(cp, 0x0F);
+  emitByte(cp, 0x6E);
+  emitByte(cp, 0xC0 | ((reg & 7) << 3));
+}
+
+// Emits sub rsp, frame (op 0xEC) or add rsp, frame (op 0xC4)
+static void emitFrame(CodeBuffer *cp, unsigned char op, int frame) {
+  emitByte(cp, 0x48);
+  emitByte(cp, 0x81);
+  emitByte(cp, op);
+  emitWord(cp, (uint32_t)frame);
+}
+
+// Returns the offset in the frame of stack entry k, which is not kept in a register
+static int frameOffset(int k) {
+  return 8 * (k - JIT_REGISTERS);
+}
+
+// Emits the code of a push of a number or identifier on stack entry k
+static void emitPush(CodeBuffer *cp, const Instruction *ip, int k) {
+  int reg = k < JIT_REGISTERS ? k : SCRATCH;
+  if (ip->op == OpNumber) {
+    emitConstant(cp, reg, ip->number);
+  } else {
+    emitRegMem(cp, MOVSD_LOAD, reg, RDI, 8 * ip->slot);
+  }
+  if (reg == SCRATCH) {
+    emitRegMem(cp, MOVSD_STORE, SCRATCH, RSP, frameOffset(k));
+  }
+}
+
+// Emits the code of stack entry k = entry k <op> entry k + 1
+static void emitOperation(CodeBuffer *cp, unsigned char op, int k) {
+  if (k + 1 < JIT_REGISTERS) {
+    emitRegReg(cp, op, k, k + 1);
+  } else if (k < JIT_REGISTERS) {
+    emitRegMem(cp, op, k, RSP, frameOffset(k + 1));
+  } else {
+    emitRegMem(cp, MOVSD_LOAD, SCRATCH, RSP, frameOffset(k));
+    emitRegMem(cp, op, SCRATCH, RSP, frameOffset(k + 1));
+    emitRegMem(cp, MOVSD_STORE, SCRATCH, RSP, frameOffset(k));
+  }
+}
+
+// Writes the machine code of the program to cp, which has room for it
+static void generate(CodeBuffer *cp, Program *pp) {
+  int frame = 0;
+  if (pp->maxDepth > JIT_REGISTERS) {
+    frame = (8 * (pp->maxDepth - JIT_REGISTERS) + 15) & ~15;
+    emitFrame(cp, 0xEC, frame);
+  }
+  int top = 0;
+  for (int i = 0; i < pp->length; i++) {
+    const Instruction *ip = &pp->code[i];
+    switch (ip->op) {
+      case OpNumber:
+      case OpVariable:
+        emitPush(cp, ip, top);
+        top++;
+        break;
+      case OpAdd:
+        top--;
+        emitOperation(cp, ADDSD, top - 1);
+        break;
+      case OpSub:
+        top--;
+        emitOperation(cp, SUBSD, top - 1);
+        break;
+      case OpMul:
+        top--;
+        emitOperation(cp, MULSD, top - 1);
+        break;
+      case OpDiv:
+        top--;
+        emitOperation(cp, DIVSD, top - 1);
+        break;
+    }
+  }
+  if (top == 0) {
+    //An empty program returns 0 like runProgram: xorpd xmm0, xmm0
+    emitByte(cp, 0x66);
+    emitByte(cp, 0x0F);
+    emitByte(cp, 0x57);
+    emitByte(cp, 0xC0);
+  }
+  if (frame > 0) {
+    emitFrame(cp, 0xC4, frame);
+  }
+  emitByte(cp, 0xC3);
+}
+
+// Makes the machine code of the program in jp, function stays NULL if that fails
+static void compileNative(JitCode *jp) {
+  size_t size = (size_t)JIT_INSTRUCTION_BYTES * (jp->program.length + 2);
+  void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    return;
+  }
+  CodeBuffer c;
+  c.bytes = memory;
+  c.length = 0;
+  generate(&c, &jp->program);
+  assert(c.length <= size);
+  if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(memory, size);
+    return;
+  }
+  jp->memory = memory;
+  jp->size = size;
+  jp->function = (JitFunction)memory;
+}
+
+#endif
+
+// Compiles the tree to machine code, the slots are numbered as compileExpTree numbers them
+JitCode compileJit(ExpTree tr) {
+  JitCode j;
+  j.program = compileExpTree(tr);
+  j.function = NULL;
+  j.memory = NULL;
+  j.size = 0;
+#if JIT_NATIVE
+  compileNative(&j);
+#endif
+  return j;
+}
+
+// Checks if the formula runs as machine code rather than in the interpreter
+int isJitNative(JitCode *jp) {
+  return jp->function != NULL;
+}
+
+// Runs the formula with the value of slot i in vars[i] and returns the value of the expression
+double runJit(JitCode *jp, const double *vars) {
+  if (jp->function == NULL) {
+    return runProgram(&jp->program, vars);
+  }
+  INSTR_BEGIN(StageEvaluate);
+  double result = jp->function(vars);
+  INSTR_END(StageEvaluate);
+  return result;
+}
+
+// Frees up the allocated space
+void freeJit(JitCode *jp) {
+#if JIT_NATIVE
+  if (jp->memory != NULL) {
+    munmap(jp->memory, jp->size);
+  }
+#endif
+  freeProgram(&jp->program);
+  jp->function = NULL;
+  jp->memory = NULL;
+  jp->size = 0;
+}
@@ -0,0 +1,28 @@
+#ifndef JITEXP_H
+#define JITEXP_H
+
+#include <stddef.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "bytecodeExp.h"
+
+// Number of stack entries kept in xmm registers, deeper entries are kept in the stack frame
+#define JIT_REGISTERS 14
+
+typedef double (*JitFunction)(const double *vars);
+
+// A formula compiled to machine code. function is NULL when no machine code could be made,
+// then the program is run by the interpreter. The slots are those of the program
+typedef struct JitCode {
+  Program program;
+  JitFunction function;
+  void *memory;
+  size_t size;
+} JitCode;
+
+JitCode compileJit(ExpTree tr);
+int isJitNative(JitCode *jp);
+double runJit(JitCode *jp, const double *vars);
+void freeJit(JitCode *jp);
+
+#endif
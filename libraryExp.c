@@ -0,0 +1,473 @@
+/* file : libraryExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Binary library files of expression trees, so formulas (for instance simplified derivatives)
+  are parsed once and then loaded by mapping the file. A formula is stored in preorder, one
+  32 bit word per node: the kind of the node in the top two bits and below it the index of its
+  number in the constant table, the index of its identifier in the identifier table or its
+  operator. Every operator has two children, so no child counts or offsets are needed: reading
+  the nodes from back to front with a stack rebuilds the tree or computes its value. Numbers and
+  identifiers are stored once per library, the identifiers as names that are interned when the
+  library is opened.
+  Opening a library maps the file and interns the identifier names, nothing is done per node.
+  valueLibraryFormula computes a value straight from the mapped words, with the same operations
+  in the same order as valueExpTree, and expandLibraryFormula rebuilds a tree in the active
+  arena. The file is written in the byte order of the machine.
+  compileLibrary makes a library of the expressions of a text file, one formula per line, and
+  printLibrary prints the formulas of a library in infix notation, so a library printed after
+  compiling gives the infix the batch mode prints for the same lines.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <math.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "scanExp.h"
+#include "symbolTable.h"
+#include "batchExp.h"
+#include "libraryExp.h"
+
+// The kinds of a node word
+#define NODE_NUMBER 0u
+#define NODE_IDENTIFIER 1u
+#define NODE_SYMBOL 2u
+
+// Values of formulas needing at most this many stack entries are computed without a malloc
+#define LIBRARY_STACK 64
+
+// Creates a writer without formulas
+LibraryWriter newLibraryWriter() {
+  LibraryWriter w;
+  w.nodeSize = 256;
+  w.nodes = malloc(w.nodeSize * sizeof(uint32_t));
+  w.nodeCount = 0;
+  w.formulaSize = 16;
+  w.offsets = malloc(w.formulaSize * sizeof(uint32_t));
+  w.formulaCount = 0;
+  w.constantSize = 16;
+  w.constants = malloc(w.constantSize * sizeof(double));
+  w.constantCount = 0;
+  w.slotCount = 64;
+  w.constantSlots = malloc(w.slotCount * sizeof(int));
+  w.nameSize = 16;
+  w.names = malloc(w.nameSize * sizeof(char *));
+  w.nameCount = 0;
+  w.nameIndexSize = 0;
+  w.nameIndex = NULL;
+  assert(w.nodes != NULL && w.offsets != NULL && w.constants != NULL && w.constantSlots != NULL && w.names != NULL);
+  memset(w.constantSlots, -1, w.slotCount * sizeof(int));
+  w.offsets[0] = 0;
+  return w;
+}
+
+// Returns the slot of the constant table index of w, or the empty slot where it belongs.
+// Constants are compared by their bits, so 0 and -0 stay apart
+static int constantSlot(LibraryWriter *wp, double w) {
+  uint64_t bits;
+  memcpy(&bits, &w, sizeof(bits));
+  int i = (int)((bits * 0x9E3779B97F4A7C15ULL) >> 40) & (wp->slotCount - 1);
+  while (wp->constantSlots[i] >= 0 && memcmp(&wp->constants[wp->constantSlots[i]], &w, sizeof(w)) != 0) {
+    i = (i + 1) & (wp->slotCount - 1);
+  }
+  return i;
+}
+
+// Returns the index of the number w in the constant table, it is added if it is new
+static uint32_t constantIndex(LibraryWriter *wp, double w) {
+  int i = constantSlot(wp, w);
+  if (wp->constantSlots[i] >= 0) {
+    return wp->constantSlots[i];
+  }
+  if (wp->constantCount == wp->constantSize) {
+    wp->constantSize = 2 * wp->constantSize;
+    wp->constants = realloc(wp->constants, wp->constantSize * sizeof(double));
+    assert(wp->constants != NULL);
+  }
+  wp->constants[wp->constantCount] = w;
+  wp->constantSlots[i] = wp->constantCount;
+  wp->constantCount++;
+  //The index is kept at most half full
+  if (2 * wp->constantCount > wp->slotCount) {
+    wp->slotCount = 2 * wp->slotCount;
+    wp->constantSlots = realloc(wp->constantSlots, wp->slotCount * sizeof(int));
+    assert(wp->constantSlots != NULL);
+    memset(wp->constantSlots, -1, wp->slotCount * sizeof(int));
+    for (int k = 0; k < wp->constantCount; k++) {
+      wp->constantSlots[constantSlot(wp, wp->constants[k])] = k;
+    }
+  }
+  return wp->constantCount - 1;
+}
+
+// Returns the index of an interned identifier in the identifier table, it is added if it is new.
+// The table index is found through the id of the identifier
+static uint32_t nameIndex(LibraryWriter *wp, char *name) {
+  int id = identifierId(name);
+  if (id >= wp->nameIndexSize) {
+    int size = 2 * id + 16;
+    wp->nameIndex = realloc(wp->nameIndex, size * sizeof(int));
+    assert(wp->nameIndex != NULL);
+    memset(wp->nameIndex + wp->nameIndexSize, -1, (size - wp->nameIndexSize) * sizeof(int));
+    wp->nameIndexSize = size;
+  }
+  if (wp->nameIndex[id] < 0) {
+    if (wp->nameCount == wp->nameSize) {
+      wp->nameSize = 2 * wp->nameSize;
+      wp->names = realloc(wp->names, wp->nameSize * sizeof(char *));
+      assert(wp->names != NULL);
+    }
+    wp->names[wp->nameCount] = name;
+    wp->nameIndex[id] = wp->nameCount;
+    wp->nameCount++;
+  }
+  return wp->nameIndex[id];
+}
+
+// Appends the word of a node
+static void emitNode(LibraryWriter *wp, uint32_t kind, uint32_t value) {
+  assert(value <= NODE_VALUE_MASK);
+  if (wp->nodeCount == wp->nodeSize) {
+    wp->nodeSize = 2 * wp->nodeSize;
+    wp->nodes = realloc(wp->nodes, wp->nodeSize * sizeof(uint32_t));
+    assert(wp->nodes != NULL);
+  }
+  wp->nodes[wp->nodeCount] = (kind << NODE_KIND_SHIFT) | value;
+  wp->nodeCount++;
+}
+
+// Adds the tree as the next formula of the library. The nodes are visited in preorder using a
+// stack, so trees of any depth can be added
+void addLibraryFormula(LibraryWriter *wp, ExpTree tr) {
+  if (tr != NULL) {
+    Stack visit = newStack(20);
+    push(&visit, tr);
+    while (!isEmptyStack(visit)) {
+      ExpTree node = pop(&visit);
+      switch (node->tt) {
+        case Number:
+          emitNode(wp, NODE_NUMBER, constantIndex(wp, node->t.number));
+          break;
+        case Identifier:
+          emitNode(wp, NODE_IDENTIFIER, nameIndex(wp, node->t.identifier));
+          break;
+        case Symbol:
+          emitNode(wp, NODE_SYMBOL, (unsigned char)node->t.symbol);
+          //The left child is popped first, so it comes right after its parent
+          push(&visit, node->right);
+          push(&visit, node->left);
+          break;
+      }
+    }
+    freeStack(visit);
+  }
+  if (wp->formulaCount + 2 > wp->formulaSize) {
+    wp->formulaSize = 2 * wp->formulaSize;
+    wp->offsets = realloc(wp->offsets, wp->formulaSize * sizeof(uint32_t));
+    assert(wp->offsets != NULL);
+  }
+  wp->formulaCount++;
+  wp->offsets[wp->formulaCount] = wp->nodeCount;
+}
+
+// Writes the formulas added so far as a library to fp. Returns 0 if writing fails
+int writeLibrary(LibraryWriter *wp, FILE *fp) {
+  LibraryHeader h;
+  memcpy(h.magic, LIBRARY_MAGIC, 4);
+  h.version = LIBRARY_VERSION;
+  h.formulaCount = wp->formulaCount;
+  h.constantCount = wp->constantCount;
+  h.nodeCount = wp->nodeCount;
+  h.nameCount = wp->nameCount;
+  h.nameBytes = 0;
+  for (int i = 0; i < wp->nameCount; i++) {
+    h.nameBytes += strlen(wp->names[i]) + 1;
+  }
+  h.reserved = 0;
+  int ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+  ok = ok && fwrite(wp->constants, sizeof(double), wp->constantCount, fp) == (size_t)wp->constantCount;
+  ok = ok && fwrite(wp->offsets, sizeof(uint32_t), wp->formulaCount + 1, fp) == (size_t)wp->formulaCount + 1;
+  ok = ok && fwrite(wp->nodes, sizeof(uint32_t), wp->nodeCount, fp) == (size_t)wp->nodeCount;
+  for (int i = 0; i < wp->nameCount && ok; i++) {
+    ok = fwrite(wp->names[i], 1, strlen(wp->names[i]) + 1, fp) == strlen(wp->names[i]) + 1;
+  }
+  return ok && fflush(fp) == 0;
+}
+
+// Frees up the allocated space
+void freeLibraryWriter(LibraryWriter *wp) {
+  free(wp->nodes);
+  free(wp->offsets);
+  free(wp->constants);
+  free(wp->constantSlots);
+  free(wp->names);
+  free(wp->nameIndex);
+  wp->nodes = NULL;
+  wp->offsets = NULL;
+  wp->constants = NULL;
+  wp->constantSlots = NULL;
+  wp->names = NULL;
+  wp->nameIndex = NULL;
+}
+
+// Maps the library file fp and interns its identifier names. Returns 0 if fp is not a regular
+// file or not a library
+int openLibrary(TreeLibrary *lp, FILE *fp) {
+  lp->names = NULL;
+  if (!mapInput(fp, &lp->map)) {
+    return 0;
+  }
+  const char *data = lp->map.data;
+  const LibraryHeader *h = (const LibraryHeader *)data;
+  if ((size_t)lp->map.length < sizeof(LibraryHeader) || memcmp(h->magic, LIBRARY_MAGIC, 4) != 0 ||
+      h->version != LIBRARY_VERSION) {
+    unmapInput(&lp->map);
+    return 0;
+  }
+  size_t start = sizeof(LibraryHeader) + h->constantCount * sizeof(double) +
+                 ((size_t)h->formulaCount + 1 + h->nodeCount) * sizeof(uint32_t);
+  if (start + h->nameBytes != (size_t)lp->map.length) {
+    unmapInput(&lp->map);
+    return 0;
+  }
+  lp->header = h;
+  lp->constants = (const double *)(data + sizeof(LibraryHeader));
+  lp->offsets = (const uint32_t *)(lp->constants + h->constantCount);
+  lp->nodes = lp->offsets + h->formulaCount + 1;
+  // The offsets must go up to the number of nodes, the nodes themselves are checked when used
+  int ok = lp->offsets[0] == 0 && lp->offsets[h->formulaCount] == h->nodeCount;
+  for (uint32_t k = 0; k < h->formulaCount && ok; k++) {
+    ok = lp->offsets[k] <= lp->offsets[k + 1];
+  }
+  //Every name takes at least two bytes, a character and its terminator, so a larger count is
+  //rejected before the table is allocated
+  if (!ok || h->nameCount > h->nameBytes / 2) {
+    unmapInput(&lp->map);
+    return 0;
+  }
+  lp->names = malloc(((size_t)h->nameCount + 1) * sizeof(char *));
+  assert(lp->names != NULL);
+  const char *name = data + start, *end = data + lp->map.length;
+  for (uint32_t i = 0; i < h->nameCount && ok; i++) {
+    const char *nul = memchr(name, '\0', end - name);
+    ok = nul != NULL && nul > name;
+    if (ok) {
+      lp->names[i] = internIdentifier(name, nul - name);
+      name = nul + 1;
+    }
+  }
+  if (!ok || name != end) {
+    closeLibrary(lp);
+    return 0;
+  }
+  return 1;
+}
+
+// Returns the number of formulas of the library
+int libraryFormulaCount(TreeLibrary *lp) {
+  return lp->header->formulaCount;
+}
+
+// Returns the index of an interned identifier in the identifier table of the library, or -1 if
+// no formula has it. valueLibraryFormula reads the value of identifier i from vars[i]
+int librarySlot(TreeLibrary *lp, const char *name) {
+  for (uint32_t i = 0; i < lp->header->nameCount; i++) {
+    if (lp->names[i] == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Checks if the node word refers to an existing constant, identifier or operator
+static int validNode(TreeLibrary *lp, uint32_t word) {
+  uint32_t value = word & NODE_VALUE_MASK;
+  switch (word >> NODE_KIND_SHIFT) {
+    case NODE_NUMBER:
+      return value < lp->header->constantCount;
+    case NODE_IDENTIFIER:
+      return value < lp->header->nameCount;
+    case NODE_SYMBOL:
+      return value == '+' || value == '-' || value == '*' || value == '/';
+  }
+  return 0;
+}
+
+// Returns the value of formula k with the value of identifier i in vars[i], straight from the
+// mapped nodes. The nodes are read from back to front, so the value of the left child of an
+// operator is on top of the stack. Returns NAN for a malformed formula
+double valueLibraryFormula(TreeLibrary *lp, int k, const double *vars) {
+  double local[LIBRARY_STACK];
+  double *stack = local;
+  int size = LIBRARY_STACK, top = 0, ok = 1;
+  const uint32_t *first = lp->nodes + lp->offsets[k];
+  const uint32_t *np = lp->nodes + lp->offsets[k + 1];
+  while (np > first) {
+    np--;
+    uint32_t value = *np & NODE_VALUE_MASK;
+    ok = validNode(lp, *np);
+    if (!ok) {
+      break;
+    }
+    if (*np >> NODE_KIND_SHIFT != NODE_SYMBOL) {
+      if (top == size) {
+        size = 2 * size;
+        if (stack == local) {
+          stack = malloc(size * sizeof(double));
+          assert(stack != NULL);
+          memcpy(stack, local, sizeof(local));
+        } else {
+          stack = realloc(stack, size * sizeof(double));
+          assert(stack != NULL);
+        }
+      }
+      stack[top] = *np >> NODE_KIND_SHIFT == NODE_NUMBER ? lp->constants[value] : vars[value];
+      top++;
+      continue;
+    }
+    ok = top >= 2;
+    if (!ok) {
+      break;
+    }
+    top--;
+    double a = stack[top], b = stack[top - 1];
+    switch (value) {
+      case '+':
+        stack[top - 1] = a + b;
+        break;
+      case '-':
+        stack[top - 1] = a - b;
+        break;
+      case '*':
+        stack[top - 1] = a * b;
+        break;
+      case '/':
+        stack[top - 1] = a / b;
+        break;
+    }
+  }
+  double result = ok && top == 1 ? stack[0] : NAN;
+  if (stack != local) {
+    free(stack);
+  }
+  return result;
+}
+
+// Returns the tree of formula k, built in the active arena, or NULL for a malformed formula.
+// The nodes are read from back to front, so the left child of an operator is on top of the stack
+ExpTree expandLibraryFormula(TreeLibrary *lp, int k) {
+  Stack built = newStack(20);
+  int ok = 1;
+  const uint32_t *first = lp->nodes + lp->offsets[k];
+  const uint32_t *np = lp->nodes + lp->offsets[k + 1];
+  while (np > first && ok) {
+    np--;
+    uint32_t value = *np & NODE_VALUE_MASK;
+    Token t;
+    ok = validNode(lp, *np);
+    if (!ok) {
+      break;
+    }
+    switch (*np >> NODE_KIND_SHIFT) {
+      case NODE_NUMBER:
+        t.number = lp->constants[value];
+        push(&built, newTreeNode(Number, t, NULL, NULL));
+        break;
+      case NODE_IDENTIFIER:
+        t.identifier = lp->names[value];
+        push(&built, newTreeNode(Identifier, t, NULL, NULL));
+        break;
+      default:
+        ok = built.top >= 2;
+        if (ok) {
+          ExpTree tL = pop(&built);
+          ExpTree tR = pop(&built);
+          t.symbol = value;
+          push(&built, newTreeNode(Symbol, t, tL, tR));
+        }
+        break;
+    }
+  }
+  ExpTree result = NULL;
+  if (ok && built.top == 1) {
+    result = pop(&built);
+  }
+  //A malformed formula leaves its partial trees on the stack, they are released with it
+  freeStack(built);
+  return result;
+}
+
+// Unmaps the library
+void closeLibrary(TreeLibrary *lp) {
+  free(lp->names);
+  lp->names = NULL;
+  unmapInput(&lp->map);
+}
+
+// Reads expressions one per line from in, until the end of the input or a line starting with
+// '!', and writes them as a library to out. With a variable the simplified derivative to it is
+// stored instead of the expression. A line that is not an expression gets an empty formula.
+// Returns 0 if writing fails
+int compileLibrary(FILE *in, FILE *out, const char *variable) {
+  char *line = NULL;
+  int size = 0;
+  Scanner scanner = newScanner();
+  NodeArena arena = newArena();
+  LibraryWriter writer = newLibraryWriter();
+  char *var = variable == NULL ? NULL : internIdentifier(variable, strlen(variable));
+  useArena(&arena);
+  while (readLine(in, &line, &size) && line[0] != '!') {
+    int n = scanTokens(&scanner, line, strlen(line));
+    ExpTree t = NULL;
+    int errorPos = 0;
+    if (parseTokenArray(scanner.tokens, n, &t, &errorPos) && var != NULL) {
+      int differingVariable = 1;
+      t = simplify(t);
+      differentiateTo(&t, var, &differingVariable);
+      t = simplify(t);
+    }
+    addLibraryFormula(&writer, t);
+    resetArena(&arena);
+  }
+  int ok = writeLibrary(&writer, out);
+  useArena(NULL);
+  freeArena(&arena);
+  freeLibraryWriter(&writer);
+  freeScanner(&scanner);
+  freeSpareStacks();
+  free(line);
+  return ok;
+}
+
+// Prints every formula of the library file in on a line of its own, "error" for an empty or
+// malformed formula. Returns 0 if in is not a library
+int printLibrary(FILE *in) {
+  TreeLibrary library;
+  if (!openLibrary(&library, in)) {
+    return 0;
+  }
+  NodeArena arena = newArena();
+  useArena(&arena);
+  for (int k = 0; k < libraryFormulaCount(&library); k++) {
+    ExpTree t = expandLibraryFormula(&library, k);
+    if (t != NULL) {
+      writeExpTreeInfix(stdout, t);
+    } else {
+      printf("error");
+    }
+    printf("\n");
+    resetArena(&arena);
+  }
+  useArena(NULL);
+  freeArena(&arena);
+  closeLibrary(&library);
+  freeSpareStacks();
+  return 1;
+}
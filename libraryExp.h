@@ -0,0 +1,74 @@
+#ifndef LIBRARYEXP_H
+#define LIBRARYEXP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "scanExp.h"
+
+#define LIBRARY_MAGIC "EXPL"
+#define LIBRARY_VERSION 1
+
+// A node is one word: the kind in the top two bits, below it the index of the constant, the
+// index of the identifier or the operator character
+#define NODE_KIND_SHIFT 30
+#define NODE_VALUE_MASK ((1u << NODE_KIND_SHIFT) - 1)
+
+// The start of a library file, followed by the constants, the formula offsets, the nodes and the
+// identifier names, in that order
+typedef struct LibraryHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t formulaCount;
+  uint32_t constantCount;
+  uint32_t nodeCount;
+  uint32_t nameCount;
+  uint32_t nameBytes;
+  uint32_t reserved;
+} LibraryHeader;
+
+// Collects formulas before they are written. Constants and identifiers are stored once
+typedef struct LibraryWriter {
+  uint32_t *nodes;
+  int nodeCount;
+  int nodeSize;
+  uint32_t *offsets;
+  int formulaCount;
+  int formulaSize;
+  double *constants;
+  int constantCount;
+  int constantSize;
+  int *constantSlots;
+  int slotCount;
+  char **names;
+  int nameCount;
+  int nameSize;
+  int *nameIndex;
+  int nameIndexSize;
+} LibraryWriter;
+
+// A mapped library file, only the identifier names are copied out of it (they are interned)
+typedef struct TreeLibrary {
+  MappedInput map;
+  const LibraryHeader *header;
+  const double *constants;
+  const uint32_t *offsets;
+  const uint32_t *nodes;
+  char **names;
+} TreeLibrary;
+
+LibraryWriter newLibraryWriter();
+void addLibraryFormula(LibraryWriter *wp, ExpTree tr);
+int writeLibrary(LibraryWriter *wp, FILE *fp);
+void freeLibraryWriter(LibraryWriter *wp);
+int openLibrary(TreeLibrary *lp, FILE *fp);
+int libraryFormulaCount(TreeLibrary *lp);
+int librarySlot(TreeLibrary *lp, const char *name);
+double valueLibraryFormula(TreeLibrary *lp, int k, const double *vars);
+ExpTree expandLibraryFormula(TreeLibrary *lp, int k);
+void closeLibrary(TreeLibrary *lp);
+int compileLibrary(FILE *in, FILE *out, const char *variable);
+int printLibrary(FILE *in);
+
+#endif
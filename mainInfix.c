@@ -1,9 +1,170 @@
 /* mainPref.c for lab assignment 4 expressions, updated 2021 */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <assert.h>
 #include "scanner.h"
 #include "infixExp.h"
+#include "batchExp.h"
+#include "parallelExp.h"
+#include "libraryExp.h"
+#include "instrumentExp.h"
 
+// Reads the whole number s of the option name into value, which must lie between min and max
+static int parseNumber(const char *name, const char *s, long min, long max, long *value) {
+  char *end;
+  errno = 0;
+  *value = strtol(s, &end, 10);
+  if (end == s || *end != '\0' || errno != 0 || *value < min || *value > max) {
+    fprintf(stderr, "%s needs a whole number from %ld to %ld, not %s\n", name, min, max, s);
+    return 0;
+  }
+  return 1;
+}
+
+// Without arguments the expressions are read interactively,
+// "-b [-j workers] [-d] [-c size] [-r size] [-s] [-v var] [-g] [-n order] [-p] [-e]
+// [-a name=value] [-l nodes] [-m megabytes] [file]" processes a file (or stdin) with one
+// expression per line, -d simplifies and differentiates on hash-consed DAGs, -c size caches
+// that many derivatives, -r size caches the records of that many expressions, -s prints how
+// often every simplification rule was applied and how many node allocations were made, -v
+// differentiates to var instead of x, -g gives the partial derivatives to all identifiers of
+// every expression, -n gives all derivatives up to order, -p brings results into canonical
+// polynomial or rational form, -e prints derivatives with their common subexpressions as
+// temporaries, -a (which may be repeated) specializes every expression for the identifier name
+// having the whole number value, -l and -m report an expression needing more nodes or memory as
+// "too large" and go on with the next one.
+// "-w library [-v var] [file]" stores the expressions (with -v their simplified derivatives to
+// var) in a binary library file and "-x library" prints the expressions of a library
 int main(int argc, char *argv[]) {
+  //Built with -DINFIX_INSTRUMENT the time and allocations of every stage are printed on exit
+  INSTR_DUMP_AT_EXIT();
+  if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+    FILE *in = stdin;
+    BatchOptions options = defaultBatchOptions();
+    Binding *bindings = malloc(argc * sizeof(Binding));
+    assert(bindings != NULL);
+    options.bindings = bindings;
+    long number;
+    for (int i = 2; i < argc; i++) {
+      if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+        i++;
+        if (!parseNumber("-j", argv[i], 0, INT_MAX, &number)) {
+          return 1;
+        }
+        options.workers = number;
+      } else if (strcmp(argv[i], "-d") == 0) {
+        options.useDag = 1;
+      } else if (strcmp(argv[i], "-s") == 0) {
+        options.ruleStats = 1;
+      } else if (strcmp(argv[i], "-e") == 0) {
+        options.cse = 1;
+      } else if (strcmp(argv[i], "-p") == 0) {
+        options.canonical = 1;
+      } else if (strcmp(argv[i], "-g") == 0) {
+        options.gradient = 1;
+      } else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+        i++;
+        options.variable = argv[i];
+      } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+        i++;
+        if (!parseNumber("-n", argv[i], 1, INT_MAX, &number)) {
+          return 1;
+        }
+        options.order = number;
+      } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+        i++;
+        if (!parseNumber("-l", argv[i], 0, LONG_MAX, &number)) {
+          return 1;
+        }
+        options.nodeBudget = number;
+      } else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+        i++;
+        if (!parseNumber("-m", argv[i], 0, LONG_MAX >> 20, &number)) {
+          return 1;
+        }
+        options.memoryBudget = number << 20;
+      } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+        i++;
+        if (!parseBinding(argv[i], &bindings[options.bindingCount])) {
+          fprintf(stderr, "%s is not of the form name=value with a whole value\n", argv[i]);
+          return 1;
+        }
+        options.bindingCount++;
+      } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+        i++;
+        if (!parseNumber("-c", argv[i], 0, INT_MAX, &number)) {
+          return 1;
+        }
+        options.cacheCapacity = number;
+      } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+        i++;
+        if (!parseNumber("-r", argv[i], 0, INT_MAX, &number)) {
+          return 1;
+        }
+        options.resultCapacity = number;
+      } else {
+        in = fopen(argv[i], "r");
+        if (in == NULL) {
+          fprintf(stderr, "cannot open %s\n", argv[i]);
+          return 1;
+        }
+      }
+    }
+    if (options.workers > 1) {
+      infixExpParallel(in, stdout, &options);
+    } else {
+      infixExpBatch(in, stdout, &options);
+    }
+    if (in != stdin) {
+      fclose(in);
+    }
+    free(bindings);
+    return 0;
+  }
+  if (argc > 2 && strcmp(argv[1], "-w") == 0) {
+    FILE *in = stdin;
+    char *variable = NULL;
+    for (int i = 3; i < argc; i++) {
+      if (strcmp(argv[i], "-v") == 0 && i + 1 < argc) {
+        i++;
+        variable = argv[i];
+      } else {
+        in = fopen(argv[i], "r");
+        if (in == NULL) {
+          fprintf(stderr, "cannot open %s\n", argv[i]);
+          return 1;
+        }
+      }
+    }
+    FILE *out = fopen(argv[2], "wb");
+    if (out == NULL) {
+      fprintf(stderr, "cannot open %s\n", argv[2]);
+      return 1;
+    }
+    int ok = compileLibrary(in, out, variable);
+    fclose(out);
+    if (in != stdin) {
+      fclose(in);
+    }
+    if (!ok) {
+      fprintf(stderr, "cannot write %s\n", argv[2]);
+      return 1;
+    }
+    return 0;
+  }
+  if (argc > 2 && strcmp(argv[1], "-x") == 0) {
+    FILE *in = fopen(argv[2], "rb");
+    if (in == NULL || !printLibrary(in)) {
+      fprintf(stderr, "%s is not an expression library\n", argv[2]);
+      return 1;
+    }
+    fclose(in);
+    return 0;
+  }
   infixExpTrees();
   return 0;
 }
@@ -0,0 +1,291 @@
+/* file : parallelExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Multithreaded version of the batch mode in batchExp.c. The input is read in rounds of
+  ROUND_LINES lines (a mapped input file is only split into lines, nothing is copied), which are split in chunks of CHUNK_LINES lines. Every worker starts with an
+  equal range of chunks and, once its own range is done, steals the upper half of the range of
+  another worker. Each worker has its own scanner, arena and stacks, the records of a chunk are
+  collected in a buffer of that chunk, so the output keeps the order of the input.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <pthread.h>
+#include "scanner.h"
+#include "scanExp.h"
+#include "infixExp.h"
+#include "batchExp.h"
+#include "cseExp.h"
+#include "rewriteExp.h"
+#include "parallelExp.h"
+#include "instrumentExp.h"
+
+// Takes the next chunk of the own range, or steals half of the range of another worker.
+// Returns -1 when there is no work left in this round
+static int takeChunk(ParallelBatch *pb, Worker *self) {
+  int chunk = -1;
+  pthread_mutex_lock(&self->lock);
+  if (self->next < self->end) {
+    chunk = self->next;
+    self->next++;
+  }
+  pthread_mutex_unlock(&self->lock);
+  if (chunk >= 0) {
+    return chunk;
+  }
+  for (int k = 1; k < pb->nWorkers && chunk < 0; k++) {
+    Worker *victim = &pb->workers[(self->id + k) % pb->nWorkers];
+    int from = 0, to = 0;
+    pthread_mutex_lock(&victim->lock);
+    if (victim->next < victim->end) {
+      //The thief takes the upper half, the owner keeps the chunks it is about to work on
+      from = victim->next + (victim->end - victim->next) / 2;
+      to = victim->end;
+      victim->end = from;
+    }
+    pthread_mutex_unlock(&victim->lock);
+    if (from < to) {
+      chunk = from;
+      pthread_mutex_lock(&self->lock);
+      self->next = from + 1;
+      self->end = to;
+      pthread_mutex_unlock(&self->lock);
+    }
+  }
+  return chunk;
+}
+
+// Processes the lines of one chunk into the output buffer of that chunk
+static void processChunk(ParallelBatch *pb, Worker *self, int chunk) {
+  int first = chunk * CHUNK_LINES;
+  int last = first + CHUNK_LINES < pb->lineCount ? first + CHUNK_LINES : pb->lineCount;
+  //The records go straight into the buffer of the chunk
+  OutBuffer own = self->context.out;
+  self->context.out = pb->chunkOut[chunk];
+  self->context.out.len = 0;
+  for (int i = first; i < last; i++) {
+    processExpression(&self->context, pb->base + pb->lineStart[i], pb->lineLength[i]);
+  }
+  pb->chunkOut[chunk] = self->context.out;
+  self->context.out = own;
+}
+
+// Processes chunks as the worker until there is no work left in this round
+static void runWorker(ParallelBatch *pb, Worker *self) {
+  int chunk = takeChunk(pb, self);
+  while (chunk >= 0) {
+    processChunk(pb, self, chunk);
+    chunk = takeChunk(pb, self);
+  }
+}
+
+// Main loop of a worker thread, one iteration per round
+static void *workerMain(void *arg) {
+  Worker *self = arg;
+  ParallelBatch *pb = self->batch;
+  //The barriers are made once all threads are created
+  pthread_mutex_lock(&pb->setup);
+  pthread_mutex_unlock(&pb->setup);
+  while (1) {
+    pthread_barrier_wait(&pb->start);
+    if (pb->finished) {
+      break;
+    }
+    runWorker(pb, self);
+    pthread_barrier_wait(&pb->done);
+  }
+  mergeRewriteStats();
+  INSTR_MERGE();
+  self->nodeMallocs = nodeMallocCount();
+  freeSpareStacks();
+  return NULL;
+}
+
+// Reads the lines of the next round into the text buffer, returns 0 at the end of the input
+static int readRound(ParallelBatch *pb, FILE *in, char **linep, int *sizep) {
+  pb->textLen = 0;
+  pb->lineCount = 0;
+  pb->base = pb->text;
+  while (pb->lineCount < ROUND_LINES && readLine(in, linep, sizep)) {
+    if ((*linep)[0] == '!') {
+      return 0;
+    }
+    int len = strlen(*linep);
+    while (pb->textLen + len + 1 > pb->textSize) {
+      pb->textSize = 2 * pb->textSize;
+      pb->text = realloc(pb->text, pb->textSize);
+      assert(pb->text != NULL);
+    }
+    memcpy(pb->text + pb->textLen, *linep, len + 1);
+    pb->lineStart[pb->lineCount] = pb->textLen;
+    pb->lineLength[pb->lineCount] = len;
+    pb->lineCount++;
+    pb->textLen += len + 1;
+    pb->base = pb->text;
+  }
+  return pb->lineCount == ROUND_LINES;
+}
+
+// Finds the lines of the next round in the mapped input, nothing is copied.
+// Returns 0 at the end of the input
+static int mapRound(ParallelBatch *pb, MappedInput *mp) {
+  const char *line;
+  int len;
+  pb->lineCount = 0;
+  pb->base = mp->data;
+  while (pb->lineCount < ROUND_LINES && nextMappedLine(mp, &line, &len)) {
+    if (len > 0 && line[0] == '!') {
+      return 0;
+    }
+    pb->lineStart[pb->lineCount] = line - mp->data;
+    pb->lineLength[pb->lineCount] = len;
+    pb->lineCount++;
+  }
+  return pb->lineCount == ROUND_LINES;
+}
+
+// Lets the workers process the lines of the current round and writes the records in order. The
+// calling thread processes the chunks of the workers whose thread could not be started
+static void runRound(ParallelBatch *pb, FILE *out) {
+  pb->nChunks = (pb->lineCount + CHUNK_LINES - 1) / CHUNK_LINES;
+  for (int w = 0; w < pb->nWorkers; w++) {
+    pb->workers[w].next = (long)pb->nChunks * w / pb->nWorkers;
+    pb->workers[w].end = (long)pb->nChunks * (w + 1) / pb->nWorkers;
+  }
+  pthread_barrier_wait(&pb->start);
+  for (int w = 0; w < pb->nWorkers; w++) {
+    if (!pb->workers[w].started) {
+      runWorker(pb, &pb->workers[w]);
+    }
+  }
+  pthread_barrier_wait(&pb->done);
+  for (int c = 0; c < pb->nChunks; c++) {
+    flushOutBuffer(&pb->chunkOut[c], out);
+  }
+}
+
+// Processes all expressions of in with op->workers threads and writes one result record per
+// line to out, in the order of the input. The input ends at end of file or at a line starting with '!'
+void infixExpParallel(FILE *in, FILE *out, BatchOptions *op) {
+  int nWorkers = op->workers < 1 ? 1 : op->workers;
+  ParallelBatch pb;
+  pb.nWorkers = nWorkers;
+  pb.textSize = MAXINPUT;
+  pb.text = malloc(pb.textSize);
+  pb.textLen = 0;
+  pb.base = pb.text;
+  pb.lineStart = malloc(ROUND_LINES * sizeof(long));
+  pb.lineLength = malloc(ROUND_LINES * sizeof(int));
+  pb.lineCount = 0;
+  pb.nChunks = 0;
+  pb.finished = 0;
+  int maxChunks = (ROUND_LINES + CHUNK_LINES - 1) / CHUNK_LINES;
+  pb.chunkOut = malloc(maxChunks * sizeof(OutBuffer));
+  pb.workers = malloc(nWorkers * sizeof(Worker));
+  assert(pb.text != NULL && pb.lineStart != NULL && pb.lineLength != NULL && pb.chunkOut != NULL && pb.workers != NULL);
+  for (int c = 0; c < maxChunks; c++) {
+    pb.chunkOut[c] = newOutBuffer(CHUNK_LINES * 64);
+  }
+  //The threads wait for the setup lock until the barriers are made for the threads that started
+  long ownMallocs = nodeMallocCount();
+  int threads = 0;
+  pthread_mutex_init(&pb.setup, NULL);
+  pthread_mutex_lock(&pb.setup);
+  for (int w = 0; w < nWorkers; w++) {
+    Worker *wp = &pb.workers[w];
+    wp->id = w;
+    wp->next = 0;
+    wp->end = 0;
+    wp->nodeMallocs = 0;
+    wp->batch = &pb;
+    wp->context = newBatchContext(op);
+    pthread_mutex_init(&wp->lock, NULL);
+    wp->started = pthread_create(&wp->thread, NULL, workerMain, wp) == 0;
+    threads += wp->started;
+  }
+  pthread_barrier_init(&pb.start, NULL, threads + 1);
+  pthread_barrier_init(&pb.done, NULL, threads + 1);
+  pthread_mutex_unlock(&pb.setup);
+
+  char *line = NULL;
+  int size = 0;
+  int more = 1;
+  MappedInput map;
+  int mapped = mapInput(in, &map);
+  while (more) {
+    more = mapped ? mapRound(&pb, &map) : readRound(&pb, in, &line, &size);
+    if (pb.lineCount > 0) {
+      runRound(&pb, out);
+    }
+  }
+  unmapInput(&map);
+  fflush(out);
+
+  pb.finished = 1;
+  pthread_barrier_wait(&pb.start);
+  //The counters of the derivative and result caches, of the common subexpressions and of the
+  //node allocations of all workers are summed up
+  DerivCache total = newDerivCache(0);
+  ResultCache resultTotal = newResultCache(0);
+  CseResult cseTotal = newCseResult();
+  if (threads < nWorkers) {
+    mergeRewriteStats();
+  }
+  long blockMallocs = 0, nodeMallocs = nodeMallocCount() - ownMallocs;
+  for (int w = 0; w < nWorkers; w++) {
+    if (pb.workers[w].started) {
+      pthread_join(pb.workers[w].thread, NULL);
+    }
+    pthread_mutex_destroy(&pb.workers[w].lock);
+    DerivCache *cp = &pb.workers[w].context.cache;
+    total.count += cp->count;
+    total.capacity += cp->capacity;
+    total.hits += cp->hits;
+    total.misses += cp->misses;
+    total.evictions += cp->evictions;
+    ResultCache *rp = &pb.workers[w].context.results;
+    resultTotal.count += rp->count;
+    resultTotal.capacity += rp->capacity;
+    resultTotal.hits += rp->hits;
+    resultTotal.misses += rp->misses;
+    resultTotal.evictions += rp->evictions;
+    cseTotal.totalBefore += pb.workers[w].context.cse->totalBefore;
+    cseTotal.totalAfter += pb.workers[w].context.cse->totalAfter;
+    blockMallocs += pb.workers[w].context.arena.blockMallocs;
+    nodeMallocs += pb.workers[w].nodeMallocs;
+    freeBatchContext(&pb.workers[w].context);
+  }
+  if (op->cacheCapacity > 0) {
+    printCacheStats(stderr, &total);
+  }
+  freeDerivCache(&total);
+  if (op->resultCapacity > 0) {
+    printResultStats(stderr, &resultTotal);
+  }
+  freeResultCache(&resultTotal);
+  if (op->cse) {
+    printCseStats(stderr, &cseTotal);
+  }
+  freeCseResult(&cseTotal);
+  if (op->ruleStats) {
+    printRewriteStats(stderr);
+    printArenaStats(stderr, blockMallocs, nodeMallocs);
+  }
+  pthread_barrier_destroy(&pb.start);
+  pthread_barrier_destroy(&pb.done);
+  pthread_mutex_destroy(&pb.setup);
+  for (int c = 0; c < maxChunks; c++) {
+    freeOutBuffer(&pb.chunkOut[c]);
+  }
+  free(pb.chunkOut);
+  free(pb.workers);
+  free(pb.lineStart);
+  free(pb.lineLength);
+  free(pb.text);
+  free(line);
+}
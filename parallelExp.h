@@ -0,0 +1,47 @@
+#ifndef PARALLELEXP_H
+#define PARALLELEXP_H
+
+#include <stdio.h>
+#include <pthread.h>
+#include "batchExp.h"
+
+// Number of lines read before the workers are started on them
+#define ROUND_LINES (1 << 16)
+// Number of lines a worker takes at once
+#define CHUNK_LINES 256
+
+struct ParallelBatch;
+
+typedef struct Worker {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  int next;
+  int end;
+  int id;
+  int started;
+  BatchContext context;
+  long nodeMallocs;
+  struct ParallelBatch *batch;
+} Worker;
+
+typedef struct ParallelBatch {
+  Worker *workers;
+  int nWorkers;
+  char *text;
+  int textLen;
+  int textSize;
+  const char *base;
+  long *lineStart;
+  int *lineLength;
+  int lineCount;
+  int nChunks;
+  OutBuffer *chunkOut;
+  pthread_mutex_t setup;
+  pthread_barrier_t start;
+  pthread_barrier_t done;
+  int finished;
+} ParallelBatch;
+
+void infixExpParallel(FILE *in, FILE *out, BatchOptions *op);
+
+#endif
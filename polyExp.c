@@ -0,0 +1,654 @@
+/* file : polyExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Canonical polynomial and rational form of expressions. simplify only removes neutral elements,
+  so (x+1)*(x+1) - x*x keeps all its nodes. canonicalExpTree turns an expression of + - * / into
+  a quotient of two sparse multivariate polynomials with whole coefficients: the monomials are
+  hashed, coefficients of equal monomials are combined, and common monomial factors, the
+  greatest common divisor of the coefficients and an exact polynomial divisor are cancelled from
+  the quotient, so a fraction like 8/3 stays a quotient and is written as ((8 * y) / 3). The
+  result is turned back into a tree as a Horner scheme that keeps factoring out the variable
+  occurring in most terms, so (x+1)*(x+1) - x*x becomes ((2 * x) + 1). The canonical tree is
+  only returned when it is smaller than the input. Expressions with more than POLY_MAX_VARS
+  identifiers, more than POLY_MAX_TERMS terms in a polynomial, a degree above POLY_MAX_DEGREE in
+  a variable, a coefficient of POLY_MAX_COEFFICIENT or more, a number that is not whole or a
+  division by zero are returned as they are.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <math.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "budgetExp.h"
+#include "polyExp.h"
+
+// The high bit of every exponent byte. Adding DEGREE_CHECK sets the high bit of the exponents
+// above POLY_MAX_DEGREE, exponents of a product stay below 128 so no byte carries into the next
+#define HIGH_BITS 0x8080808080808080ULL
+#define DEGREE_CHECK (0x0101010101010101ULL * (127 - POLY_MAX_DEGREE))
+
+// The variables of the expression being converted, sorted by name, variable k is byte k of a
+// monomial. failed is set when a limit is passed
+typedef struct PolyContext {
+  char *vars[POLY_MAX_VARS];
+  int nVars;
+  int failed;
+} PolyContext;
+
+// Creates an empty polynomial with room for size terms
+static Poly newPoly(int size) {
+  Poly p;
+  p.size = size < 4 ? 4 : size;
+  p.count = 0;
+  p.slotCount = 8;
+  while (p.slotCount < 2 * p.size) {
+    p.slotCount *= 2;
+  }
+  p.terms = malloc(p.size * sizeof(PolyTerm));
+  p.slots = malloc(p.slotCount * sizeof(int));
+  assert(p.terms != NULL && p.slots != NULL);
+  memset(p.slots, -1, p.slotCount * sizeof(int));
+  return p;
+}
+
+// Frees up the allocated space
+static void freePoly(Poly *pp) {
+  free(pp->terms);
+  free(pp->slots);
+  pp->terms = NULL;
+  pp->slots = NULL;
+  pp->count = 0;
+}
+
+// Returns the slot of monomial m, or the empty slot where it belongs
+static int slotOf(Poly *pp, uint64_t m) {
+  int i = (int)((m * 0x9E3779B97F4A7C15ULL) >> 40) & (pp->slotCount - 1);
+  while (pp->slots[i] >= 0 && pp->terms[pp->slots[i]].monomial != m) {
+    i = (i + 1) & (pp->slotCount - 1);
+  }
+  return i;
+}
+
+// Rebuilds the index after the terms moved
+static void reindex(Poly *pp) {
+  memset(pp->slots, -1, pp->slotCount * sizeof(int));
+  for (int k = 0; k < pp->count; k++) {
+    pp->slots[slotOf(pp, pp->terms[k].monomial)] = k;
+  }
+}
+
+// Adds c times the monomial m, it is combined with the term of m if there is one
+static void addTerm(PolyContext *cx, Poly *pp, uint64_t m, double c) {
+  int i = slotOf(pp, m);
+  if (pp->slots[i] >= 0) {
+    pp->terms[pp->slots[i]].coefficient += c;
+    return;
+  }
+  if (pp->count == POLY_MAX_TERMS) {
+    cx->failed = 1;
+    return;
+  }
+  if (pp->count == pp->size) {
+    pp->size *= 2;
+    pp->slotCount *= 2;
+    pp->terms = realloc(pp->terms, pp->size * sizeof(PolyTerm));
+    pp->slots = realloc(pp->slots, pp->slotCount * sizeof(int));
+    assert(pp->terms != NULL && pp->slots != NULL);
+    reindex(pp);
+    i = slotOf(pp, m);
+  }
+  pp->terms[pp->count].monomial = m;
+  pp->terms[pp->count].coefficient = c;
+  pp->slots[i] = pp->count;
+  pp->count++;
+}
+
+// Returns the exponent of variable k in m
+static int exponent(uint64_t m, int k) {
+  return (m >> (8 * k)) & 0xFF;
+}
+
+// Returns the total degree of m
+static int degree(uint64_t m) {
+  int d = 0;
+  while (m != 0) {
+    d += m & 0xFF;
+    m >>= 8;
+  }
+  return d;
+}
+
+// Orders terms by total degree and then by monomial, largest first
+static int compareTerms(const void *a, const void *b) {
+  uint64_t ma = ((const PolyTerm *)a)->monomial, mb = ((const PolyTerm *)b)->monomial;
+  int da = degree(ma), db = degree(mb);
+  if (da != db) {
+    return da > db ? -1 : 1;
+  }
+  return ma > mb ? -1 : (ma < mb ? 1 : 0);
+}
+
+// Drops the terms with a zero coefficient and sorts the others, so equal polynomials have equal
+// term arrays and the leading term comes first
+static void normalizePoly(PolyContext *cx, Poly *pp) {
+  int n = 0;
+  for (int k = 0; k < pp->count; k++) {
+    if (pp->terms[k].coefficient != 0) {
+      if (!(fabs(pp->terms[k].coefficient) < POLY_MAX_COEFFICIENT)) {
+        cx->failed = 1;
+      }
+      pp->terms[n] = pp->terms[k];
+      n++;
+    }
+  }
+  pp->count = n;
+  qsort(pp->terms, n, sizeof(PolyTerm), compareTerms);
+  reindex(pp);
+}
+
+// Returns the polynomial of a constant
+static Poly constantPoly(PolyContext *cx, double c) {
+  Poly p = newPoly(1);
+  if (c != 0) {
+    addTerm(cx, &p, 0, c);
+  }
+  return p;
+}
+
+// Returns a copy of a polynomial
+static Poly copyPoly(Poly *pp) {
+  Poly p = newPoly(pp->count);
+  memcpy(p.terms, pp->terms, pp->count * sizeof(PolyTerm));
+  p.count = pp->count;
+  reindex(&p);
+  return p;
+}
+
+// Checks if the polynomial is a constant, which is stored in c
+static int isConstantPoly(Poly *pp, double *c) {
+  if (pp->count == 0) {
+    *c = 0;
+    return 1;
+  }
+  if (pp->count == 1 && pp->terms[0].monomial == 0) {
+    *c = pp->terms[0].coefficient;
+    return 1;
+  }
+  return 0;
+}
+
+// Checks if two normalized polynomials are equal
+static int equalPolys(Poly *a, Poly *b) {
+  return a->count == b->count && memcmp(a->terms, b->terms, a->count * sizeof(PolyTerm)) == 0;
+}
+
+// Returns a + sign * b
+static Poly addPolys(PolyContext *cx, Poly *a, Poly *b, double sign) {
+  Poly p = newPoly(a->count + b->count);
+  for (int k = 0; k < a->count; k++) {
+    addTerm(cx, &p, a->terms[k].monomial, a->terms[k].coefficient);
+  }
+  for (int k = 0; k < b->count; k++) {
+    addTerm(cx, &p, b->terms[k].monomial, sign * b->terms[k].coefficient);
+  }
+  normalizePoly(cx, &p);
+  return p;
+}
+
+// Returns a * b
+static Poly multiplyPolys(PolyContext *cx, Poly *a, Poly *b) {
+  int n = a->count * b->count;
+  Poly p = newPoly(n < POLY_MAX_TERMS ? n : POLY_MAX_TERMS);
+  for (int i = 0; i < a->count && !cx->failed; i++) {
+    for (int j = 0; j < b->count && !cx->failed; j++) {
+      uint64_t m = a->terms[i].monomial + b->terms[j].monomial;
+      if ((m + DEGREE_CHECK) & HIGH_BITS) {
+        cx->failed = 1;
+      } else {
+        addTerm(cx, &p, m, a->terms[i].coefficient * b->terms[j].coefficient);
+      }
+    }
+  }
+  normalizePoly(cx, &p);
+  return p;
+}
+
+// Divides all coefficients by c, which divides each of them
+static void dividePoly(Poly *pp, double c) {
+  for (int k = 0; k < pp->count; k++) {
+    pp->terms[k].coefficient /= c;
+  }
+}
+
+// Multiplies all coefficients by c
+static void scalePoly(PolyContext *cx, Poly *pp, double c) {
+  for (int k = 0; k < pp->count; k++) {
+    pp->terms[k].coefficient *= c;
+    if (!(fabs(pp->terms[k].coefficient) < POLY_MAX_COEFFICIENT)) {
+      cx->failed = 1;
+    }
+  }
+}
+
+// Returns the greatest common divisor of two whole numbers
+static double gcdOf(double a, double b) {
+  a = fabs(a);
+  b = fabs(b);
+  while (b != 0) {
+    double r = fmod(a, b);
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+// Returns the greatest common divisor of the coefficients of a nonzero polynomial, with the sign
+// of the leading coefficient
+static double contentOf(Poly *pp) {
+  double g = 0;
+  for (int k = 0; k < pp->count; k++) {
+    g = gcdOf(g, pp->terms[k].coefficient);
+  }
+  return pp->terms[0].coefficient < 0 ? -g : g;
+}
+
+// Checks if monomial m is a multiple of monomial d: every exponent of m is at least that of d
+static int isMultiple(uint64_t m, uint64_t d) {
+  return (((m | HIGH_BITS) - d) & HIGH_BITS) == HIGH_BITS;
+}
+
+// Returns the greatest common divisor of two monomials, the lowest exponent of every variable
+static uint64_t commonMonomial(uint64_t a, uint64_t b) {
+  uint64_t m = 0;
+  for (int k = 0; k < POLY_MAX_VARS; k++) {
+    uint64_t ea = exponent(a, k), eb = exponent(b, k);
+    m |= (ea < eb ? ea : eb) << (8 * k);
+  }
+  return m;
+}
+
+// Divides num by den with the division algorithm, both normalized and den with whole coefficients
+// that have no common divisor. Returns 1 with the quotient in q if the remainder is zero, else q
+// is not made. By Gauss's lemma an exact quotient then has whole coefficients, so a step that
+// would need a fraction ends the division
+static int divideExact(PolyContext *cx, Poly *num, Poly *den, Poly *q) {
+  Poly r = copyPoly(num);
+  PolyTerm lead = den->terms[0];
+  *q = newPoly(4);
+  for (int step = 0; r.count > 0 && step < POLY_MAX_TERMS && !cx->failed; step++) {
+    PolyTerm t = r.terms[0];
+    if (!isMultiple(t.monomial, lead.monomial) || fmod(t.coefficient, lead.coefficient) != 0) {
+      break;
+    }
+    uint64_t m = t.monomial - lead.monomial;
+    double c = t.coefficient / lead.coefficient;
+    addTerm(cx, q, m, c);
+    //r - c * m * den, the leading term is removed as a whole so rounding cannot keep it alive
+    for (int k = 1; k < den->count; k++) {
+      uint64_t mk = den->terms[k].monomial + m;
+      if ((mk + DEGREE_CHECK) & HIGH_BITS) {
+        cx->failed = 1;
+        break;
+      }
+      addTerm(cx, &r, mk, -c * den->terms[k].coefficient);
+    }
+    r.terms[0].coefficient = 0;
+    normalizePoly(cx, &r);
+  }
+  int exact = r.count == 0 && !cx->failed;
+  freePoly(&r);
+  if (!exact) {
+    freePoly(q);
+    return 0;
+  }
+  normalizePoly(cx, q);
+  return 1;
+}
+
+// Frees up the allocated space
+static void freeRational(Rational *rp) {
+  freePoly(&rp->num);
+  freePoly(&rp->den);
+}
+
+// Cancels what the numerator and denominator have in common: a common monomial factor, a
+// denominator dividing the numerator and the greatest common divisor of the coefficients. The
+// leading coefficient of the denominator is made positive
+static void normalizeRational(PolyContext *cx, Rational *rp) {
+  double c;
+  if (cx->failed) {
+    return;
+  }
+  if (isConstantPoly(&rp->den, &c) && c == 0) {
+    cx->failed = 1;
+    return;
+  }
+  if (rp->num.count == 0) {
+    freePoly(&rp->den);
+    rp->den = constantPoly(cx, 1);
+    return;
+  }
+  uint64_t g = rp->num.terms[0].monomial;
+  for (int k = 0; k < rp->num.count; k++) {
+    g = commonMonomial(g, rp->num.terms[k].monomial);
+  }
+  for (int k = 0; k < rp->den.count; k++) {
+    g = commonMonomial(g, rp->den.terms[k].monomial);
+  }
+  if (g != 0) {
+    //Every exponent is at least that of g, so the order of the terms stays the same
+    for (int k = 0; k < rp->num.count; k++) {
+      rp->num.terms[k].monomial -= g;
+    }
+    for (int k = 0; k < rp->den.count; k++) {
+      rp->den.terms[k].monomial -= g;
+    }
+    reindex(&rp->num);
+    reindex(&rp->den);
+  }
+  //The contents are taken out and put back as a reduced fraction cn / cd
+  double cn = contentOf(&rp->num), cd = contentOf(&rp->den);
+  dividePoly(&rp->num, cn);
+  dividePoly(&rp->den, cd);
+  Poly q;
+  if (divideExact(cx, &rp->num, &rp->den, &q)) {
+    freeRational(rp);
+    rp->num = q;
+    rp->den = constantPoly(cx, 1);
+  }
+  double common = gcdOf(cn, cd);
+  scalePoly(cx, &rp->num, (cd < 0 ? -cn : cn) / common);
+  scalePoly(cx, &rp->den, fabs(cd) / common);
+}
+
+// Returns a + sign * b, a and b are freed
+static Rational addRationals(PolyContext *cx, Rational *a, Rational *b, double sign) {
+  Rational r;
+  if (equalPolys(&a->den, &b->den)) {
+    r.num = addPolys(cx, &a->num, &b->num, sign);
+    r.den = copyPoly(&a->den);
+  } else {
+    Poly x = multiplyPolys(cx, &a->num, &b->den);
+    Poly y = multiplyPolys(cx, &b->num, &a->den);
+    r.num = addPolys(cx, &x, &y, sign);
+    r.den = multiplyPolys(cx, &a->den, &b->den);
+    freePoly(&x);
+    freePoly(&y);
+  }
+  freeRational(a);
+  freeRational(b);
+  normalizeRational(cx, &r);
+  return r;
+}
+
+// Returns a * b, or a / b when divide is set. a and b are freed
+static Rational multiplyRationals(PolyContext *cx, Rational *a, Rational *b, int divide) {
+  Rational r;
+  if (divide && b->num.count == 0) {
+    cx->failed = 1;
+  }
+  r.num = multiplyPolys(cx, &a->num, divide ? &b->den : &b->num);
+  r.den = multiplyPolys(cx, &a->den, divide ? &b->num : &b->den);
+  freeRational(a);
+  freeRational(b);
+  normalizeRational(cx, &r);
+  return r;
+}
+
+// Returns the index of the interned identifier name among the variables, -1 if it is not there
+static int variableIndex(PolyContext *cx, char *name) {
+  for (int k = 0; k < cx->nVars; k++) {
+    if (cx->vars[k] == name) {
+      return k;
+    }
+  }
+  return -1;
+}
+
+// Lists the nodes of tr in postorder, *n is set to their number. Returns NULL if tr has more
+// than POLY_MAX_NODES nodes
+static ExpTree *postorderNodes(ExpTree tr, int *n) {
+  int size = 64, count = 0;
+  ExpTree *order = malloc(size * sizeof(ExpTree));
+  assert(order != NULL);
+  Stack visit = newStack(20);
+  push(&visit, tr);
+  while (!isEmptyStack(visit)) {
+    if (count == POLY_MAX_NODES) {
+      //The nodes left on the stack belong to the tree, they must not be released by freeStack
+      visit.top = 0;
+      free(order);
+      order = NULL;
+      break;
+    }
+    ExpTree node = pop(&visit);
+    if (count == size) {
+      size = 2 * size;
+      order = realloc(order, size * sizeof(ExpTree));
+      assert(order != NULL);
+    }
+    order[count] = node;
+    count++;
+    if (node->left != NULL) {
+      push(&visit, node->left);
+    }
+    if (node->right != NULL) {
+      push(&visit, node->right);
+    }
+  }
+  freeStack(visit);
+  //The nodes were listed parent first and right before left, reversed they are in postorder
+  for (int i = 0, j = count - 1; order != NULL && i < j; i++, j--) {
+    ExpTree tmp = order[i];
+    order[i] = order[j];
+    order[j] = tmp;
+  }
+  *n = count;
+  return order;
+}
+
+// Converts the n nodes in postorder into a rational function, cx->failed is set on a limit
+static Rational toRational(PolyContext *cx, ExpTree *order, int n) {
+  Rational *values = calloc(n + 1, sizeof(Rational));
+  assert(values != NULL);
+  int top = 0;
+  for (int i = 0; i < n && !cx->failed; i++) {
+    ExpTree node = order[i];
+    if (node->tt != Symbol) {
+      values[top].den = constantPoly(cx, 1);
+      if (node->tt == Number) {
+        if (fmod(node->t.number, 1) != 0) {
+          cx->failed = 1;
+        }
+        values[top].num = constantPoly(cx, node->t.number);
+      } else {
+        values[top].num = newPoly(1);
+        addTerm(cx, &values[top].num, 1ULL << (8 * variableIndex(cx, node->t.identifier)), 1);
+      }
+      top++;
+      continue;
+    }
+    top--;
+    Rational *a = &values[top - 1], *b = &values[top];
+    switch (node->t.symbol) {
+      case '+':
+        *a = addRationals(cx, a, b, 1);
+        break;
+      case '-':
+        *a = addRationals(cx, a, b, -1);
+        break;
+      case '*':
+        *a = multiplyRationals(cx, a, b, 0);
+        break;
+      case '/':
+        *a = multiplyRationals(cx, a, b, 1);
+        break;
+      default:
+        abort();
+    }
+  }
+  //On a failure the values left on the stack are dropped
+  while (top > 1) {
+    top--;
+    freeRational(&values[top]);
+  }
+  Rational r = values[0];
+  free(values);
+  return r;
+}
+
+// Returns a new number node
+static ExpTree numberNode(double w) {
+  Token t;
+  t.number = w;
+  return newTreeNode(Number, t, NULL, NULL);
+}
+
+// Returns a new operator node
+static ExpTree operationNode(char op, ExpTree tL, ExpTree tR) {
+  Token t;
+  t.symbol = op;
+  return newTreeNode(Symbol, t, tL, tR);
+}
+
+// Builds the n terms as a Horner scheme: the variable occurring in most terms is factored out,
+// p = q * v + r, and q and r are built the same way. The monomials of the terms are changed.
+// *negated is set when the tree is the negation of the terms
+static ExpTree buildTerms(PolyContext *cx, PolyTerm *terms, int n, int *negated) {
+  *negated = 0;
+  if (n == 0) {
+    return numberNode(0);
+  }
+  int counts[POLY_MAX_VARS] = {0};
+  for (int k = 0; k < n; k++) {
+    for (int v = 0; v < cx->nVars; v++) {
+      if (exponent(terms[k].monomial, v) > 0) {
+        counts[v]++;
+      }
+    }
+  }
+  int best = -1;
+  for (int v = 0; v < cx->nVars; v++) {
+    if (counts[v] > 0 && (best < 0 || counts[v] > counts[best])) {
+      best = v;
+    }
+  }
+  if (best < 0) {
+    //The monomials are distinct, so a polynomial without variables is a single constant
+    *negated = terms[0].coefficient < 0;
+    return numberNode(fabs(terms[0].coefficient));
+  }
+  //The terms with the variable go first and are divided by it
+  int k = 0;
+  for (int i = 0; i < n; i++) {
+    if (exponent(terms[i].monomial, best) > 0) {
+      PolyTerm tmp = terms[i];
+      terms[i] = terms[k];
+      terms[k] = tmp;
+      terms[k].monomial -= 1ULL << (8 * best);
+      k++;
+    }
+  }
+  int negQ, negR;
+  ExpTree q = buildTerms(cx, terms, k, &negQ);
+  Token t;
+  t.identifier = cx->vars[best];
+  ExpTree product = newTreeNode(Identifier, t, NULL, NULL);
+  if (q->tt != Number || q->t.number != 1) {
+    product = operationNode('*', q, product);
+  }
+  if (k == n) {
+    *negated = negQ;
+    return product;
+  }
+  ExpTree r = buildTerms(cx, terms + k, n - k, &negR);
+  if (negQ == negR) {
+    *negated = negQ;
+    return operationNode('+', product, r);
+  }
+  return negR ? operationNode('-', product, r) : operationNode('-', r, product);
+}
+
+// Builds the tree of a rational function, the polynomials are freed
+static ExpTree buildRational(PolyContext *cx, Rational *rp) {
+  double c;
+  int numCount = rp->num.count, denCount = rp->den.count;
+  int withDen = !(isConstantPoly(&rp->den, &c) && c == 1);
+  //The terms are copied into one tracked array, so an exceeded budget while the nodes are made
+  //does not lose them
+  PolyTerm *terms = malloc((numCount + denCount + 1) * sizeof(PolyTerm));
+  assert(terms != NULL);
+  memcpy(terms, rp->num.terms, numCount * sizeof(PolyTerm));
+  memcpy(terms + numCount, rp->den.terms, denCount * sizeof(PolyTerm));
+  freeRational(rp);
+  trackScratch(terms, (numCount + denCount + 1) * sizeof(PolyTerm));
+  int negNum, negDen = 0;
+  ExpTree result = buildTerms(cx, terms, numCount, &negNum);
+  if (withDen) {
+    result = operationNode('/', result, buildTerms(cx, terms + numCount, denCount, &negDen));
+  }
+  untrackScratch(terms);
+  free(terms);
+  if (negNum != negDen) {
+    if (result->tt == Number) {
+      result->t.number = -result->t.number;
+    } else {
+      result = operationNode('-', numberNode(0), result);
+    }
+  }
+  return result;
+}
+
+// Returns the canonical polynomial or rational form of tr if that has fewer nodes, else tr.
+// The nodes are made with newTreeNode, in the active arena if there is one
+ExpTree canonicalExpTree(ExpTree tr) {
+  if (tr == NULL) {
+    return tr;
+  }
+  int n;
+  ExpTree *order = postorderNodes(tr, &n);
+  if (order == NULL) {
+    return tr;
+  }
+  PolyContext cx;
+  cx.nVars = 0;
+  cx.failed = 0;
+  for (int i = 0; i < n && !cx.failed; i++) {
+    if (order[i]->tt == Identifier && variableIndex(&cx, order[i]->t.identifier) < 0) {
+      if (cx.nVars == POLY_MAX_VARS) {
+        cx.failed = 1;
+      } else {
+        cx.vars[cx.nVars] = order[i]->t.identifier;
+        cx.nVars++;
+      }
+    }
+  }
+  //Sorted by name, the form does not depend on the order identifiers were interned in
+  for (int i = 1; i < cx.nVars; i++) {
+    for (int j = i; j > 0 && strcmp(cx.vars[j - 1], cx.vars[j]) > 0; j--) {
+      char *tmp = cx.vars[j];
+      cx.vars[j] = cx.vars[j - 1];
+      cx.vars[j - 1] = tmp;
+    }
+  }
+  if (cx.failed) {
+    free(order);
+    return tr;
+  }
+  Rational r = toRational(&cx, order, n);
+  free(order);
+  if (cx.failed) {
+    freeRational(&r);
+    return tr;
+  }
+  ExpTree result = buildRational(&cx, &r);
+  return sizeExpTree(result) < n ? result : tr;
+}
@@ -0,0 +1,40 @@
+#ifndef POLYEXP_H
+#define POLYEXP_H
+
+#include <stdint.h>
+#include "scanner.h"
+#include "prefixExp.h"
+
+// Limits of the canonical form, an expression passing one of them is left as it is
+#define POLY_MAX_VARS 8
+#define POLY_MAX_DEGREE 64
+#define POLY_MAX_TERMS 512
+#define POLY_MAX_NODES (1 << 16)
+// Coefficients are whole numbers, below 2^53 a double holds them exactly
+#define POLY_MAX_COEFFICIENT 9007199254740992.0
+
+// A monomial keeps the exponent of variable k in byte k, so multiplying two monomials is
+// adding their words
+typedef struct PolyTerm {
+  uint64_t monomial;
+  double coefficient;
+} PolyTerm;
+
+// A sparse polynomial, slots is an open addressing index from monomial to term so equal
+// monomials are combined as they are added
+typedef struct Poly {
+  PolyTerm *terms;
+  int count;
+  int size;
+  int *slots;
+  int slotCount;
+} Poly;
+
+typedef struct Rational {
+  Poly num;
+  Poly den;
+} Rational;
+
+ExpTree canonicalExpTree(ExpTree tr);
+
+#endif
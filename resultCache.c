@@ -0,0 +1,176 @@
+/* file : resultCache.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Bounded cache of whole result records. A small set of expressions often makes up most of the
+  input, and every line is otherwise scanned, parsed, simplified and differentiated again. An
+  entry maps the normalized text of an expression to its record. The text is normalized by
+  dropping whitespace, except a single space between two letters or digits, where it separates
+  tokens, so lines giving the same tokens share an entry. findResult looks up a line and
+  remembers its key, storeResult stores the record of the line looked up last. When the cache
+  is full the least recently used entry is evicted.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <ctype.h>
+#include "resultCache.h"
+
+// Creates an empty cache holding at most capacity records
+ResultCache newResultCache(int capacity) {
+  ResultCache c;
+  c.tableSize = 64;
+  while (c.tableSize < capacity) {
+    c.tableSize = 2 * c.tableSize;
+  }
+  c.table = calloc(c.tableSize, sizeof(ResultEntry *));
+  assert(c.table != NULL);
+  c.newest = NULL;
+  c.oldest = NULL;
+  c.count = 0;
+  c.capacity = capacity;
+  c.hits = 0;
+  c.misses = 0;
+  c.evictions = 0;
+  c.keySize = 64;
+  c.key = malloc(c.keySize);
+  assert(c.key != NULL);
+  c.keyLength = 0;
+  c.keyHash = 0;
+  return c;
+}
+
+// Stores the normalized text of the length characters of line in cp->key, with its hash
+static void normalizeKey(ResultCache *cp, const char *line, int length) {
+  if (length > cp->keySize) {
+    cp->keySize = length > 2 * cp->keySize ? length : 2 * cp->keySize;
+    cp->key = realloc(cp->key, cp->keySize);
+    assert(cp->key != NULL);
+  }
+  int n = 0, space = 0;
+  unsigned long h = 5381;
+  for (int i = 0; i < length; i++) {
+    unsigned char c = line[i];
+    if (isspace(c)) {
+      space = 1;
+      continue;
+    }
+    //A space is kept where it separates two tokens that would otherwise be read as one. It takes
+    //the place of a skipped space, so the key is never longer than the line
+    if (space && n > 0 && isalnum((unsigned char)cp->key[n - 1]) && isalnum(c)) {
+      cp->key[n] = ' ';
+      n++;
+      h = 33 * h + ' ';
+    }
+    space = 0;
+    cp->key[n] = c;
+    n++;
+    h = 33 * h + c;
+  }
+  cp->keyLength = n;
+  cp->keyHash = h;
+}
+
+// Unlinks an entry from the list of entries ordered by last use
+static void unlinkEntry(ResultCache *cp, ResultEntry *e) {
+  if (e->newer != NULL) {
+    e->newer->older = e->older;
+  } else {
+    cp->newest = e->older;
+  }
+  if (e->older != NULL) {
+    e->older->newer = e->newer;
+  } else {
+    cp->oldest = e->newer;
+  }
+}
+
+// Makes an entry the most recently used one
+static void linkNewest(ResultCache *cp, ResultEntry *e) {
+  e->newer = NULL;
+  e->older = cp->newest;
+  if (cp->newest != NULL) {
+    cp->newest->newer = e;
+  } else {
+    cp->oldest = e;
+  }
+  cp->newest = e;
+}
+
+// Removes the least recently used entry
+static void evictOldest(ResultCache *cp) {
+  ResultEntry *e = cp->oldest;
+  unlinkEntry(cp, e);
+  ResultEntry **link = &cp->table[e->hash & (cp->tableSize - 1)];
+  while (*link != e) {
+    link = &(*link)->chain;
+  }
+  *link = e->chain;
+  free(e);
+  cp->count--;
+  cp->evictions++;
+}
+
+// Returns the entry of the expression in the length characters of line, or NULL if the cache
+// does not have it. The record of the entry is e->text + e->keyLength
+ResultEntry *findResult(ResultCache *cp, const char *line, int length) {
+  normalizeKey(cp, line, length);
+  ResultEntry *e = cp->table[cp->keyHash & (cp->tableSize - 1)];
+  while (e != NULL) {
+    if (e->hash == cp->keyHash && e->keyLength == cp->keyLength &&
+        memcmp(e->text, cp->key, cp->keyLength) == 0) {
+      cp->hits++;
+      unlinkEntry(cp, e);
+      linkNewest(cp, e);
+      return e;
+    }
+    e = e->chain;
+  }
+  cp->misses++;
+  return NULL;
+}
+
+// Stores the record of length characters for the expression findResult looked up last
+void storeResult(ResultCache *cp, const char *record, int length) {
+  if (cp->capacity <= 0) {
+    return;
+  }
+  if (cp->count == cp->capacity) {
+    evictOldest(cp);
+  }
+  ResultEntry *e = malloc(sizeof(ResultEntry) + cp->keyLength + length);
+  assert(e != NULL);
+  e->hash = cp->keyHash;
+  e->keyLength = cp->keyLength;
+  e->recordLength = length;
+  memcpy(e->text, cp->key, cp->keyLength);
+  memcpy(e->text + cp->keyLength, record, length);
+  int b = e->hash & (cp->tableSize - 1);
+  e->chain = cp->table[b];
+  cp->table[b] = e;
+  linkNewest(cp, e);
+  cp->count++;
+}
+
+// Prints the hit, miss and eviction counters of the cache
+void printResultStats(FILE *fp, ResultCache *cp) {
+  long lookups = cp->hits + cp->misses;
+  fprintf(fp, "result cache: %d/%d entries, %ld hits, %ld misses, %ld evictions, hit rate %.1f%%\n",
+          cp->count, cp->capacity, cp->hits, cp->misses, cp->evictions,
+          lookups == 0 ? 0.0 : 100.0 * cp->hits / lookups);
+}
+
+// Frees up the allocated space
+void freeResultCache(ResultCache *cp) {
+  while (cp->oldest != NULL) {
+    evictOldest(cp);
+  }
+  free(cp->table);
+  free(cp->key);
+  cp->table = NULL;
+  cp->key = NULL;
+}
@@ -0,0 +1,40 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <stdio.h>
+
+// A result record and the normalized text of the expression it belongs to, in one allocation:
+// text holds the key followed by the record
+typedef struct ResultEntry {
+  unsigned long hash;
+  int keyLength;
+  int recordLength;
+  struct ResultEntry *chain;
+  struct ResultEntry *newer;
+  struct ResultEntry *older;
+  char text[];
+} ResultEntry;
+
+typedef struct ResultCache {
+  ResultEntry **table;
+  int tableSize;
+  ResultEntry *newest;
+  ResultEntry *oldest;
+  int count;
+  int capacity;
+  long hits;
+  long misses;
+  long evictions;
+  char *key;
+  int keyLength;
+  int keySize;
+  unsigned long keyHash;
+} ResultCache;
+
+ResultCache newResultCache(int capacity);
+ResultEntry *findResult(ResultCache *cp, const char *line, int length);
+void storeResult(ResultCache *cp, const char *record, int length);
+void printResultStats(FILE *fp, ResultCache *cp);
+void freeResultCache(ResultCache *cp);
+
+#endif
@@ -0,0 +1,354 @@
+/* file : rewriteExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Rule based simplifier. Every rule of the rule table rewrites the root of a tree in place
+  when its pattern matches: constant folding, identity and annihilator rules, cancellation of
+  e - e and e / e, and collection of like terms c*e + d*e. rewriteNode applies the rules to a
+  node until none matches, simplifyFixpoint does bottom-up passes over the whole tree until a
+  pass changes nothing, with at most REWRITE_MAX_PASSES passes.
+  For every rule the number of applications and the number of nodes it eliminated is counted.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "rewriteExp.h"
+
+static int foldConstants(ExpTree t);
+static int addZero(ExpTree t);
+static int subtractZero(ExpTree t);
+static int multiplyOne(ExpTree t);
+static int multiplyZero(ExpTree t);
+static int divideOne(ExpTree t);
+static int divideZero(ExpTree t);
+static int cancelSubtraction(ExpTree t);
+static int cancelDivision(ExpTree t);
+static int collectLikeTerms(ExpTree t);
+
+// The rules are tried in this order, an op of 0 means the rule is tried for every operator
+static Rule rules[] = {
+  {"fold constants", 0, foldConstants},
+  {"e + 0, 0 + e", '+', addZero},
+  {"e - 0", '-', subtractZero},
+  {"e * 1, 1 * e", '*', multiplyOne},
+  {"e * 0, 0 * e", '*', multiplyZero},
+  {"e / 1", '/', divideOne},
+  {"0 / e", '/', divideZero},
+  {"e - e", '-', cancelSubtraction},
+  {"e / e", '/', cancelDivision},
+  {"like terms", 0, collectLikeTerms},
+};
+
+#define RULE_COUNT ((int)(sizeof(rules) / sizeof(rules[0])))
+
+// The counters of the running thread, and the totals merged from all threads
+static _Thread_local RuleStats threadStats[RULE_COUNT];
+static _Thread_local long released = 0;
+static RuleStats totalStats[RULE_COUNT];
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Releases a subtree that is no longer part of the tree being simplified
+static void dropTree(ExpTree tr) {
+  released += sizeExpTree(tr);
+  releaseExpTree(tr);
+}
+
+// Creates a node that becomes part of the tree being simplified
+static ExpTree makeNode(TokenType tt, Token t, ExpTree tL, ExpTree tR) {
+  released--;
+  return newTreeNode(tt, t, tL, tR);
+}
+
+// Moves the contents of src into t and releases the node src, which is a child of t
+static void replaceBy(ExpTree t, ExpTree src) {
+  t->tt = src->tt;
+  t->t = src->t;
+  t->left = src->left;
+  t->right = src->right;
+  released++;
+  releaseNode(src);
+}
+
+// Turns t into the number w, its children are released
+static void makeNumber(ExpTree t, double w) {
+  dropTree(t->left);
+  dropTree(t->right);
+  t->tt = Number;
+  t->t.number = w;
+  t->left = NULL;
+  t->right = NULL;
+}
+
+// Checks if the node is the number w
+static int isNumber(ExpTree tr, double w) {
+  return tr->tt == Number && tr->t.number == w;
+}
+
+// Computes n op m for the numbers of both children
+static int foldConstants(ExpTree t) {
+  if (t->left->tt != Number || t->right->tt != Number) {
+    return 0;
+  }
+  double a = t->left->t.number, b = t->right->t.number;
+  switch (t->t.symbol) {
+    case '+':
+      makeNumber(t, a + b);
+      return 1;
+    case '-':
+      makeNumber(t, a - b);
+      return 1;
+    case '*':
+      makeNumber(t, a * b);
+      return 1;
+    case '/':
+      //Division by zero is left for the evaluation to report, a quotient that is not a whole
+      //number stays n / m since a number is printed and scanned as an integer
+      if (b == 0 || fmod(a, b) != 0) {
+        return 0;
+      }
+      makeNumber(t, a / b);
+      return 1;
+  }
+  return 0;
+}
+
+// Recognizes and simplifies e + 0 and 0 + e
+static int addZero(ExpTree t) {
+  ExpTree keep;
+  if (isNumber(t->right, 0)) {
+    keep = t->left;
+    dropTree(t->right);
+  } else if (isNumber(t->left, 0)) {
+    keep = t->right;
+    dropTree(t->left);
+  } else {
+    return 0;
+  }
+  replaceBy(t, keep);
+  return 1;
+}
+
+// Recognizes and simplifies e - 0
+static int subtractZero(ExpTree t) {
+  if (!isNumber(t->right, 0)) {
+    return 0;
+  }
+  dropTree(t->right);
+  replaceBy(t, t->left);
+  return 1;
+}
+
+// Recognizes and simplifies e * 1 and 1 * e
+static int multiplyOne(ExpTree t) {
+  ExpTree keep;
+  if (isNumber(t->right, 1)) {
+    keep = t->left;
+    dropTree(t->right);
+  } else if (isNumber(t->left, 1)) {
+    keep = t->right;
+    dropTree(t->left);
+  } else {
+    return 0;
+  }
+  replaceBy(t, keep);
+  return 1;
+}
+
+// Recognizes and simplifies e * 0 and 0 * e
+static int multiplyZero(ExpTree t) {
+  if (!isNumber(t->right, 0) && !isNumber(t->left, 0)) {
+    return 0;
+  }
+  makeNumber(t, 0);
+  return 1;
+}
+
+// Recognizes and simplifies e / 1
+static int divideOne(ExpTree t) {
+  if (!isNumber(t->right, 1)) {
+    return 0;
+  }
+  dropTree(t->right);
+  replaceBy(t, t->left);
+  return 1;
+}
+
+// Recognizes and simplifies 0 / e, unless e is the number 0
+static int divideZero(ExpTree t) {
+  if (!isNumber(t->left, 0) || t->right->tt == Number) {
+    return 0;
+  }
+  makeNumber(t, 0);
+  return 1;
+}
+
+// Recognizes and simplifies e - e
+static int cancelSubtraction(ExpTree t) {
+  if (!equalExpTree(t->left, t->right)) {
+    return 0;
+  }
+  makeNumber(t, 0);
+  return 1;
+}
+
+// Recognizes and simplifies e / e, unless e is the number 0
+static int cancelDivision(ExpTree t) {
+  if (t->left->tt == Number || !equalExpTree(t->left, t->right)) {
+    return 0;
+  }
+  makeNumber(t, 1);
+  return 1;
+}
+
+// Splits a term in a numeric coefficient and the rest: c * e and e * c give c and e, other terms 1
+static double coefficient(ExpTree tr, ExpTree *base) {
+  if (tr->tt == Symbol && tr->t.symbol == '*') {
+    if (tr->left->tt == Number) {
+      *base = tr->right;
+      return tr->left->t.number;
+    }
+    if (tr->right->tt == Number) {
+      *base = tr->left;
+      return tr->right->t.number;
+    }
+  }
+  *base = tr;
+  return 1;
+}
+
+// Recognizes c*e + d*e and c*e - d*e, where c or d may be missing, and rewrites it to (c + d) * e
+static int collectLikeTerms(ExpTree t) {
+  if ((t->t.symbol != '+' && t->t.symbol != '-') || t->left->tt == Number || t->right->tt == Number) {
+    return 0;
+  }
+  ExpTree baseL, baseR;
+  double c = coefficient(t->left, &baseL);
+  double d = coefficient(t->right, &baseR);
+  if (!equalExpTree(baseL, baseR)) {
+    return 0;
+  }
+  //The left base is kept, everything else of the two terms is released
+  ExpTree oldL = t->left, oldR = t->right;
+  Token tok;
+  tok.number = (t->t.symbol == '+') ? c + d : c - d;
+  ExpTree factor = makeNode(Number, tok, NULL, NULL);
+  if (oldL != baseL) {
+    if (oldL->left == baseL) {
+      oldL->left = NULL;
+    } else {
+      oldL->right = NULL;
+    }
+    dropTree(oldL);
+  }
+  dropTree(oldR);
+  t->t.symbol = '*';
+  t->left = factor;
+  t->right = baseL;
+  return 1;
+}
+
+// Applies the rules to the root of t until none matches, the children of t must be simplified.
+// Returns the number of rules applied
+int rewriteNode(ExpTree t) {
+  int applied = 0;
+  int changed = 1;
+  while (changed && t->tt == Symbol) {
+    changed = 0;
+    for (int i = 0; i < RULE_COUNT && !changed; i++) {
+      if (rules[i].op != 0 && rules[i].op != t->t.symbol) {
+        continue;
+      }
+      long before = released;
+      if (rules[i].apply(t)) {
+        threadStats[i].hits++;
+        threadStats[i].eliminated += released - before;
+        changed = 1;
+        applied++;
+      }
+    }
+  }
+  return applied;
+}
+
+// One bottom-up pass over the tree, returns the number of rules applied.
+// The nodes are visited in postorder using two stacks
+static int rewritePass(ExpTree t) {
+  int applied = 0;
+  if (t == NULL) {
+    return 0;
+  }
+  Stack visit = newStack(20);
+  Stack postorder = newStack(20);
+  push(&visit, t);
+  while (!isEmptyStack(visit)) {
+    ExpTree node = pop(&visit);
+    if (node->tt == Symbol) {
+      push(&postorder, node);
+      push(&visit, node->left);
+      push(&visit, node->right);
+    }
+  }
+  //Children come off the stack before their parents
+  while (!isEmptyStack(postorder)) {
+    applied += rewriteNode(pop(&postorder));
+  }
+  freeStack(visit);
+  freeStack(postorder);
+  return applied;
+}
+
+// Simplifies the tree until no rule applies anymore, or REWRITE_MAX_PASSES passes are done
+ExpTree simplifyFixpoint(ExpTree t) {
+  for (int pass = 0; pass < REWRITE_MAX_PASSES; pass++) {
+    if (rewritePass(t) == 0) {
+      break;
+    }
+  }
+  return t;
+}
+
+// Returns the number of rules in the rule table
+int ruleCount() {
+  return RULE_COUNT;
+}
+
+// Returns the rule table
+Rule *ruleTable() {
+  return rules;
+}
+
+// Returns the counters of the running thread, one per rule
+RuleStats *rewriteStats() {
+  return threadStats;
+}
+
+// Adds the counters of the running thread to the totals and clears them
+void mergeRewriteStats() {
+  pthread_mutex_lock(&statsLock);
+  for (int i = 0; i < RULE_COUNT; i++) {
+    totalStats[i].hits += threadStats[i].hits;
+    totalStats[i].eliminated += threadStats[i].eliminated;
+    threadStats[i].hits = 0;
+    threadStats[i].eliminated = 0;
+  }
+  pthread_mutex_unlock(&statsLock);
+}
+
+// Prints the merged totals, per rule the number of applications and of eliminated nodes
+void printRewriteStats(FILE *fp) {
+  pthread_mutex_lock(&statsLock);
+  for (int i = 0; i < RULE_COUNT; i++) {
+    fprintf(fp, "rule %-14s %10ld hits %10ld nodes eliminated\n", rules[i].name, totalStats[i].hits, totalStats[i].eliminated);
+  }
+  pthread_mutex_unlock(&statsLock);
+}
@@ -0,0 +1,32 @@
+#ifndef REWRITEEXP_H
+#define REWRITEEXP_H
+
+#include <stdio.h>
+#include "scanner.h"
+#include "prefixExp.h"
+
+// The simplifier stops after this many passes, even if rules still apply
+#define REWRITE_MAX_PASSES 16
+
+typedef int (*RuleFunction)(ExpTree t);
+
+typedef struct Rule {
+  char *name;
+  char op;
+  RuleFunction apply;
+} Rule;
+
+typedef struct RuleStats {
+  long hits;
+  long eliminated;
+} RuleStats;
+
+int rewriteNode(ExpTree t);
+ExpTree simplifyFixpoint(ExpTree t);
+int ruleCount();
+Rule *ruleTable();
+void mergeRewriteStats();
+RuleStats *rewriteStats();
+void printRewriteStats(FILE *fp);
+
+#endif
@@ -0,0 +1,203 @@
+/* file : scanExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Scanner of the batch mode. Unlike tokenList it does not need a line of its own: it tokenizes a
+  span of characters, which may lie inside a memory mapped input file, into an array of tokens
+  that is reused for every line. Identifiers are interned in the symbol table (see symbolTable.c),
+  the name table of a scanner caches the names it has seen so the shared table is only locked for
+  new names. After the first lines of a file tokenizing does not allocate at all.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <ctype.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "scanner.h"
+#include "symbolTable.h"
+#include "scanExp.h"
+#include "instrumentExp.h"
+
+// Creates an empty name table
+NameTable newNameTable() {
+  NameTable nt;
+  nt.tableSize = 64;
+  nt.slots = calloc(nt.tableSize, sizeof(char *));
+  assert(nt.slots != NULL);
+  nt.count = 0;
+  return nt;
+}
+
+// Hash of the n characters of s
+static unsigned long hashName(const char *s, int n) {
+  unsigned long h = 5381;
+  for (int i = 0; i < n; i++) {
+    h = 33 * h + (unsigned char)s[i];
+  }
+  return h;
+}
+
+// Doubles the table and reinserts the names
+static void growNameTable(NameTable *np) {
+  char **old = np->slots;
+  int oldSize = np->tableSize;
+  np->tableSize = 2 * oldSize;
+  np->slots = calloc(np->tableSize, sizeof(char *));
+  assert(np->slots != NULL);
+  for (int i = 0; i < oldSize; i++) {
+    if (old[i] != NULL) {
+      unsigned long k = hashName(old[i], strlen(old[i])) & (np->tableSize - 1);
+      while (np->slots[k] != NULL) {
+        k = (k + 1) & (np->tableSize - 1);
+      }
+      np->slots[k] = old[i];
+    }
+  }
+  free(old);
+}
+
+// Returns the interned name of the n characters of s (see symbolTable.c). Names seen before by
+// this table are found without taking the lock of the symbol table
+char *internName(NameTable *np, const char *s, int n) {
+  unsigned long k = hashName(s, n) & (np->tableSize - 1);
+  while (np->slots[k] != NULL) {
+    if (strncmp(np->slots[k], s, n) == 0 && np->slots[k][n] == '\0') {
+      return np->slots[k];
+    }
+    k = (k + 1) & (np->tableSize - 1);
+  }
+  char *name = internIdentifier(s, n);
+  np->slots[k] = name;
+  np->count++;
+  //The table is kept at most half full
+  if (2 * np->count > np->tableSize) {
+    growNameTable(np);
+  }
+  return name;
+}
+
+// Frees up the allocated space, the interned names stay
+void freeNameTable(NameTable *np) {
+  free(np->slots);
+  np->slots = NULL;
+  np->tableSize = 0;
+  np->count = 0;
+}
+
+// Creates a scanner with an empty token array, it grows with the longest line scanned
+Scanner newScanner() {
+  Scanner sc;
+  sc.tokens = NULL;
+  sc.count = 0;
+  sc.size = 0;
+  sc.names = newNameTable();
+  return sc;
+}
+
+// Tokenizes the length characters of text like tokenList does into sp->tokens and returns the
+// number of tokens. The text does not have to end with '\0'. The tokens are valid until the
+// next call on the same scanner
+int scanTokens(Scanner *sp, const char *text, int length) {
+  INSTR_BEGIN(StageScan);
+  //Every token takes at least one character, so the array never has to grow while scanning
+  if (length > sp->size) {
+    sp->size = length > 2 * sp->size ? length : 2 * sp->size;
+    sp->tokens = realloc(sp->tokens, sp->size * sizeof(ScanToken));
+    assert(sp->tokens != NULL);
+  }
+  int n = 0, i = 0;
+  while (i < length) {
+    char c = text[i];
+    if (isspace((unsigned char)c)) {
+      i++;
+      continue;
+    }
+    ScanToken *tp = &sp->tokens[n];
+    n++;
+    if (isdigit((unsigned char)c)) {
+      double w = 0;
+      while (i < length && isdigit((unsigned char)text[i])) {
+        w = 10 * w + (text[i] - '0');
+        i++;
+      }
+      tp->tt = Number;
+      tp->t.number = w;
+    } else if (isalpha((unsigned char)c)) {
+      int start = i;
+      while (i < length && isalnum((unsigned char)text[i])) {
+        i++;
+      }
+      tp->tt = Identifier;
+      tp->t.identifier = internName(&sp->names, text + start, i - start);
+    } else {
+      tp->tt = Symbol;
+      tp->t.symbol = c;
+      i++;
+    }
+  }
+  sp->count = n;
+  INSTR_END(StageScan);
+  return n;
+}
+
+// Frees up the allocated space
+void freeScanner(Scanner *sp) {
+  free(sp->tokens);
+  freeNameTable(&sp->names);
+  sp->tokens = NULL;
+  sp->count = 0;
+  sp->size = 0;
+}
+
+// Maps the regular file fp read only into memory. Returns 0 when fp cannot be mapped, for
+// instance when it is a pipe, then it has to be read line by line
+int mapInput(FILE *fp, MappedInput *mp) {
+  struct stat st;
+  mp->data = NULL;
+  mp->length = 0;
+  mp->pos = 0;
+  if (fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    return 0;
+  }
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+  if (data == MAP_FAILED) {
+    return 0;
+  }
+  //The file is read from front to back
+  madvise(data, st.st_size, MADV_SEQUENTIAL);
+  mp->data = data;
+  mp->length = st.st_size;
+  return 1;
+}
+
+// Gives the next line of the mapped input without its line end. Returns 0 at the end of the input
+int nextMappedLine(MappedInput *mp, const char **linep, int *lengthp) {
+  if (mp->pos >= mp->length) {
+    return 0;
+  }
+  const char *start = mp->data + mp->pos;
+  const char *end = memchr(start, '\n', mp->length - mp->pos);
+  long len = end == NULL ? mp->length - mp->pos : end - start;
+  mp->pos += end == NULL ? len : len + 1;
+  while (len > 0 && start[len - 1] == '\r') {
+    len--;
+  }
+  *linep = start;
+  *lengthp = len;
+  return 1;
+}
+
+// Unmaps the input
+void unmapInput(MappedInput *mp) {
+  if (mp->data != NULL) {
+    munmap((void *)mp->data, mp->length);
+  }
+  mp->data = NULL;
+  mp->length = 0;
+  mp->pos = 0;
+}
@@ -0,0 +1,42 @@
+#ifndef SCANEXP_H
+#define SCANEXP_H
+
+#include <stdio.h>
+#include "scanner.h"
+
+// A token of a scanned line. Identifiers point at their interned name
+typedef struct ScanToken {
+  TokenType tt;
+  Token t;
+} ScanToken;
+
+typedef struct NameTable {
+  char **slots;
+  int tableSize;
+  int count;
+} NameTable;
+
+typedef struct Scanner {
+  ScanToken *tokens;
+  int count;
+  int size;
+  NameTable names;
+} Scanner;
+
+typedef struct MappedInput {
+  const char *data;
+  long length;
+  long pos;
+} MappedInput;
+
+NameTable newNameTable();
+char *internName(NameTable *np, const char *s, int n);
+void freeNameTable(NameTable *np);
+Scanner newScanner();
+int scanTokens(Scanner *sp, const char *text, int length);
+void freeScanner(Scanner *sp);
+int mapInput(FILE *fp, MappedInput *mp);
+int nextMappedLine(MappedInput *mp, const char **linep, int *lengthp);
+void unmapInput(MappedInput *mp);
+
+#endif
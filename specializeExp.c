@@ -0,0 +1,108 @@
+/* file : specializeExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Partial evaluation of an expression for known identifier values. An expression is often
+  evaluated with most identifiers fixed and only one or two varying. specializeExpTree copies the
+  tree with the bound identifiers replaced by their values and folds the constant subtrees while
+  the copy is built: every new node gets the rules of rewriteExp.c applied, so 2*3 and 4/2 become
+  numbers and e*0, e+0 and the like disappear as soon as their children are known. The residual
+  tree only contains the unbound identifiers and can be compiled for repeated evaluation (see
+  bytecodeExp.c and jitExp.c). When all identifiers are bound it is a single number, unless it
+  divides by zero, which is left for the evaluation to report.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <math.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "rewriteExp.h"
+#include "symbolTable.h"
+#include "specializeExp.h"
+
+// Reads a binding name=value from s, the name is interned. Returns 0 if s is not of that form.
+// Like the numbers of the grammar the value must be whole, so the specialized tree can be
+// printed and scanned again without losing precision
+int parseBinding(const char *s, Binding *bp) {
+  const char *eq = strchr(s, '=');
+  if (eq == NULL || eq == s) {
+    return 0;
+  }
+  char *end;
+  double value = strtod(eq + 1, &end);
+  if (end == eq + 1 || *end != '\0' || fmod(value, 1) != 0) {
+    return 0;
+  }
+  bp->name = internIdentifier(s, eq - s);
+  bp->value = value;
+  return 1;
+}
+
+// Returns the binding of an interned identifier, or NULL if it is not bound
+static Binding *findBinding(Binding *bindings, int n, char *name) {
+  for (int i = 0; i < n; i++) {
+    if (bindings[i].name == name) {
+      return &bindings[i];
+    }
+  }
+  return NULL;
+}
+
+// Returns a copy of the leaf tr, a bound identifier becomes its value
+static ExpTree specializeLeaf(ExpTree tr, Binding *bindings, int n) {
+  Token t = tr->t;
+  if (tr->tt == Identifier) {
+    Binding *bp = findBinding(bindings, n, tr->t.identifier);
+    if (bp != NULL) {
+      t.number = bp->value;
+      return newTreeNode(Number, t, NULL, NULL);
+    }
+  }
+  return newTreeNode(tr->tt, t, NULL, NULL);
+}
+
+// Returns the residual tree of tr for the n bindings, tr itself is not changed. The nodes are
+// visited in postorder using two stacks, the copies of the children are kept on a third stack
+ExpTree specializeExpTree(ExpTree tr, Binding *bindings, int n) {
+  if (tr == NULL) {
+    return NULL;
+  }
+  Stack visit = newStack(20);
+  Stack postorder = newStack(20);
+  Stack copies = newStack(20);
+  push(&visit, tr);
+  while (!isEmptyStack(visit)) {
+    ExpTree node = pop(&visit);
+    push(&postorder, node);
+    if (node->tt == Symbol) {
+      push(&visit, node->left);
+      push(&visit, node->right);
+    }
+  }
+  //Children come off the stack before their parents, so the copies of both children are on top
+  while (!isEmptyStack(postorder)) {
+    ExpTree node = pop(&postorder);
+    if (node->tt != Symbol) {
+      push(&copies, specializeLeaf(node, bindings, n));
+    } else {
+      ExpTree tR = pop(&copies);
+      ExpTree tL = pop(&copies);
+      ExpTree copy = newTreeNode(Symbol, node->t, tL, tR);
+      rewriteNode(copy);
+      push(&copies, copy);
+    }
+  }
+  ExpTree result = pop(&copies);
+  freeStack(visit);
+  freeStack(postorder);
+  freeStack(copies);
+  //Rules that made new nodes may leave work for another pass
+  return simplify(result);
+}
@@ -0,0 +1,16 @@
+#ifndef SPECIALIZEEXP_H
+#define SPECIALIZEEXP_H
+
+#include "scanner.h"
+#include "prefixExp.h"
+
+// A constant value for an identifier, name is interned
+typedef struct Binding {
+  char *name;
+  double value;
+} Binding;
+
+int parseBinding(const char *s, Binding *bp);
+ExpTree specializeExpTree(ExpTree tr, Binding *bindings, int n);
+
+#endif
@@ -0,0 +1,108 @@
+/* file : symbolTable.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  The symbol table of the program. Every distinct identifier name is stored once and gets a small
+  id, numbered 0, 1, 2, ... in order of first appearance. The parsers put the interned name in the
+  tree nodes, so two identifiers are equal exactly when their pointers are, and the id of a node is
+  found without a lookup. Interned names are never freed, so nodes may share and copy them freely.
+  The table is shared by all threads and guarded by a mutex; the scanners of the batch modes keep
+  a local cache in front of it (see scanExp.c).
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "symbolTable.h"
+
+static pthread_mutex_t symbolLock = PTHREAD_MUTEX_INITIALIZER;
+static SymbolEntry **slots = NULL;
+static int tableSize = 0;
+static SymbolEntry **byId = NULL;
+static int symbolCount = 0;
+static int idSize = 0;
+
+// Hash of the n characters of s
+static unsigned long hashSymbol(const char *s, int n) {
+  unsigned long h = 5381;
+  for (int i = 0; i < n; i++) {
+    h = 33 * h + (unsigned char)s[i];
+  }
+  return h;
+}
+
+// Doubles the table and reinserts the entries
+static void growSymbols() {
+  int newSize = tableSize == 0 ? 256 : 2 * tableSize;
+  SymbolEntry **table = calloc(newSize, sizeof(SymbolEntry *));
+  assert(table != NULL);
+  for (int i = 0; i < symbolCount; i++) {
+    unsigned long k = hashSymbol(byId[i]->name, strlen(byId[i]->name)) & (newSize - 1);
+    while (table[k] != NULL) {
+      k = (k + 1) & (newSize - 1);
+    }
+    table[k] = byId[i];
+  }
+  free(slots);
+  slots = table;
+  tableSize = newSize;
+}
+
+// Returns the interned name of the n characters of s, it is added to the table if it is new
+char *internIdentifier(const char *s, int n) {
+  pthread_mutex_lock(&symbolLock);
+  //The table is kept at most half full
+  if (2 * (symbolCount + 1) > tableSize) {
+    growSymbols();
+  }
+  unsigned long k = hashSymbol(s, n) & (tableSize - 1);
+  while (slots[k] != NULL) {
+    if (strncmp(slots[k]->name, s, n) == 0 && slots[k]->name[n] == '\0') {
+      pthread_mutex_unlock(&symbolLock);
+      return slots[k]->name;
+    }
+    k = (k + 1) & (tableSize - 1);
+  }
+  SymbolEntry *e = malloc(sizeof(SymbolEntry) + n + 1);
+  assert(e != NULL);
+  memcpy(e->name, s, n);
+  e->name[n] = '\0';
+  if (symbolCount == idSize) {
+    idSize = idSize == 0 ? 64 : 2 * idSize;
+    byId = realloc(byId, idSize * sizeof(SymbolEntry *));
+    assert(byId != NULL);
+  }
+  e->id = symbolCount;
+  byId[symbolCount] = e;
+  symbolCount++;
+  slots[k] = e;
+  pthread_mutex_unlock(&symbolLock);
+  return e->name;
+}
+
+// Returns the id of an interned name
+int identifierId(const char *name) {
+  return ((const SymbolEntry *)(name - offsetof(SymbolEntry, name)))->id;
+}
+
+// Returns the interned name with the given id
+char *identifierName(int id) {
+  pthread_mutex_lock(&symbolLock);
+  assert(id >= 0 && id < symbolCount);
+  char *name = byId[id]->name;
+  pthread_mutex_unlock(&symbolLock);
+  return name;
+}
+
+// Returns the number of interned names, every id is below it
+int identifierCount() {
+  pthread_mutex_lock(&symbolLock);
+  int count = symbolCount;
+  pthread_mutex_unlock(&symbolLock);
+  return count;
+}
@@ -0,0 +1,15 @@
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+// An interned identifier: tokens and tree nodes point at name, the id is stored just before it
+typedef struct SymbolEntry {
+  int id;
+  char name[];
+} SymbolEntry;
+
+char *internIdentifier(const char *s, int n);
+int identifierId(const char *name);
+char *identifierName(int id);
+int identifierCount();
+
+#endif
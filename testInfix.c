@@ -0,0 +1,499 @@
+/* file : testInfix.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Checks of the expression pipeline on seeded random expressions, their simplified derivatives
+  and second derivatives. Every check writes one line "<check>: <cases> cases, <failures>
+  failures" and the program exits with 1 when a check failed:
+    bytecode  runProgram gives values bit-identical to valueExpTree on the tree with the
+              identifiers replaced by their values
+    gradient  gradientProgram and gradientRows give the partial derivatives that evaluating the
+              simplified derivative to every identifier gives, up to rounding
+    library   every tree written into a library file and expanded again prints with
+              printExpTreeInfix as the tree it was made of
+    jit       runJit gives values bit-identical to runProgram, also on right nested trees deep
+              enough to keep stack entries in the stack frame of the machine code
+    arena     parsing, simplifying and differentiating in an arena that is reset after every
+              expression mallocs no node on its own (nodeMallocCount stays the same) and only
+              the blocks the largest expression needs
+  Built with -DINFIX_NO_JIT the jit check covers the interpreter fallback of runJit.
+  The program is built from all sources except mainInfix.c and benchInfix.c, for instance
+    gcc -O2 -o testInfix testInfix.c <the other .c files> -lpthread -lm
+
+  usage: testInfix [-n count] [-r seed]
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "infixExp.h"
+#include "arenaExp.h"
+#include "batchExp.h"
+#include "bytecodeExp.h"
+#include "adjointExp.h"
+#include "libraryExp.h"
+#include "jitExp.h"
+
+// Number of points every expression is evaluated at
+#define TEST_POINTS 8
+// Expressions with more identifiers are left out of the checks
+#define TEST_SLOTS 16
+// Relative difference allowed between the reverse mode and the symbolic partial derivatives,
+// which round differently
+#define TEST_TOLERANCE 1e-6
+// Nesting depths of the right nested trees of the jit check
+static const int jitDepths[3] = {JIT_REGISTERS + 1, 100, 4001};
+// Number of failures of a check that are written out
+#define TEST_SHOWN 5
+
+static const char *identifierPool[5] = {"x", "y", "z", "a", "b1"};
+
+// xorshift64* generator, the same seed always gives the same expressions
+static unsigned long nextRandom(unsigned long *state) {
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  return *state * 2685821657736338717UL;
+}
+
+// Returns a random number in 0 .. n-1
+static int randomBelow(unsigned long *state, int n) {
+  return (int)((nextRandom(state) >> 33) % (unsigned long)n);
+}
+
+// Appends a random expression of + - * / with leaves leaves and at most depth levels
+static void generate(OutBuffer *bp, unsigned long *state, int leaves, int depth) {
+  if (leaves <= 1 || depth <= 1) {
+    if (randomBelow(state, 2) == 0) {
+      appendString(bp, identifierPool[randomBelow(state, 5)]);
+    } else {
+      appendChar(bp, '1' + randomBelow(state, 9));
+    }
+    return;
+  }
+  int left = 1 + randomBelow(state, leaves - 1);
+  appendChar(bp, '(');
+  generate(bp, state, left, depth - 1);
+  appendChar(bp, ' ');
+  appendChar(bp, "+-*/"[randomBelow(state, 4)]);
+  appendChar(bp, ' ');
+  generate(bp, state, leaves - left, depth - 1);
+  appendChar(bp, ')');
+}
+
+// Parses count random expressions and adds their simplified first and second derivatives to x.
+// The trees are made in the active arena, *n is set to their number
+static ExpTree *makeCorpus(int count, unsigned long seed, int *n) {
+  unsigned long state = seed == 0 ? 1 : seed;
+  OutBuffer text = newOutBuffer(256);
+  ExpTree *trees = malloc((3 * count + 1) * sizeof(ExpTree));
+  assert(trees != NULL);
+  *n = 0;
+  for (int i = 0; i < count; i++) {
+    text.len = 0;
+    generate(&text, &state, 2 + randomBelow(&state, 12), 8);
+    appendChar(&text, '\0');
+    List tl = tokenList(text.data);
+    List l = tl;
+    ExpTree t = NULL;
+    int errorPos;
+    int parsed = parseInfixExpr(&l, &t, &errorPos);
+    freeTokenList(tl);
+    if (!parsed) {
+      continue;
+    }
+    trees[*n] = t;
+    (*n)++;
+    for (int order = 0; order < 2; order++) {
+      int differingVariable = 1;
+      t = simplify(duplicate(t));
+      differentiate(&t, &differingVariable);
+      t = simplify(t);
+      trees[*n] = t;
+      (*n)++;
+    }
+  }
+  freeOutBuffer(&text);
+  return trees;
+}
+
+// Returns the value of identifier name at point p, some of them are 0 so that divisions by zero
+// are met as well
+static double pointValue(const char *name, int p) {
+  unsigned h = 0;
+  for (const char *c = name; *c != '\0'; c++) {
+    h = 31 * h + (unsigned char)*c;
+  }
+  return ((int)((h * 7 + p * 13) % 17) - 8) * 0.375;
+}
+
+// Returns a copy of tr with every identifier replaced by its value at point p
+static ExpTree substitute(ExpTree tr, int p) {
+  Token t = tr->t;
+  if (tr->tt == Identifier) {
+    t.number = pointValue(tr->t.identifier, p);
+    return newTreeNode(Number, t, NULL, NULL);
+  }
+  if (tr->tt == Number) {
+    return newTreeNode(Number, t, NULL, NULL);
+  }
+  return newTreeNode(Symbol, t, substitute(tr->left, p), substitute(tr->right, p));
+}
+
+// Checks if valueExpTree can evaluate the numerical tree, it asserts on a division by zero.
+// The value is stored in *vp
+static int safeForValue(ExpTree tr, double *vp) {
+  double a, b;
+  if (tr->tt == Number) {
+    *vp = tr->t.number;
+    return 1;
+  }
+  if (!safeForValue(tr->left, &a) || !safeForValue(tr->right, &b)) {
+    return 0;
+  }
+  switch (tr->t.symbol) {
+    case '+':
+      *vp = a + b;
+      return 1;
+    case '-':
+      *vp = a - b;
+      return 1;
+    case '*':
+      *vp = a * b;
+      return 1;
+  }
+  *vp = a / b;
+  return b != 0;
+}
+
+// Sets the value of every slot of the program at point p, returns 0 if it has too many slots
+static int bindSlots(Program *pp, int p, double *vars) {
+  if (pp->nameCount > TEST_SLOTS) {
+    return 0;
+  }
+  for (int k = 0; k < pp->nameCount; k++) {
+    vars[k] = pointValue(pp->names[k], p);
+  }
+  return 1;
+}
+
+// Writes the result line of a check, returns 1 if it had no failures
+static int report(const char *check, long cases, long failures) {
+  printf("%s: %ld cases, %ld failures\n", check, cases, failures);
+  return failures == 0;
+}
+
+// Writes a failing tree with the two values that differ
+static void showFailure(const char *check, long failures, ExpTree tr, double expected, double actual) {
+  if (failures > TEST_SHOWN) {
+    return;
+  }
+  fprintf(stderr, "%s: ", check);
+  writeExpTreeInfix(stderr, tr);
+  fprintf(stderr, " gives %.17g instead of %.17g\n", actual, expected);
+}
+
+// Compares runProgram with valueExpTree on the substituted trees
+static int checkBytecode(ExpTree *trees, int n, NodeArena *work) {
+  long cases = 0, failures = 0;
+  double vars[TEST_SLOTS];
+  for (int i = 0; i < n; i++) {
+    Program program = compileExpTree(trees[i]);
+    for (int p = 0; p < TEST_POINTS && bindSlots(&program, p, vars); p++) {
+      useArena(work);
+      ExpTree s = substitute(trees[i], p);
+      double expected;
+      if (safeForValue(s, &expected)) {
+        expected = valueExpTree(s);
+        double actual = runProgram(&program, vars);
+        cases++;
+        if (memcmp(&expected, &actual, sizeof(double)) != 0) {
+          failures++;
+          showFailure("bytecode", failures, trees[i], expected, actual);
+        }
+      }
+      resetArena(work);
+      useArena(NULL);
+    }
+    freeProgram(&program);
+  }
+  return report("bytecode", cases, failures);
+}
+
+// Checks if a and b are equal up to TEST_TOLERANCE relative to the larger of them
+static int closeTo(double a, double b) {
+  double scale = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
+  return fabs(a - b) <= TEST_TOLERANCE * (scale > 1 ? scale : 1);
+}
+
+// Compares the gradient of the reverse mode tape with the programs of the simplified derivatives
+// to every slot. Points where a value is not finite are left out. gradientRows must give the
+// same numbers as gradientProgram for the points taken as rows
+static int checkGradients(ExpTree *trees, int n, NodeArena *work) {
+  long cases = 0, failures = 0;
+  double vars[TEST_SLOTS], grad[TEST_SLOTS], sub[TEST_SLOTS];
+  double columns[TEST_SLOTS][TEST_POINTS], rowGrads[TEST_SLOTS][TEST_POINTS];
+  double values[TEST_POINTS], pointGrads[TEST_SLOTS][TEST_POINTS];
+  const double *columnPointers[TEST_SLOTS];
+  double *gradPointers[TEST_SLOTS];
+  Program partials[TEST_SLOTS];
+  for (int i = 0; i < n; i++) {
+    Program program = compileExpTree(trees[i]);
+    int nVars = program.nameCount;
+    if (nVars > TEST_SLOTS) {
+      freeProgram(&program);
+      continue;
+    }
+    Tape tape = newTape(&program);
+    useArena(work);
+    for (int k = 0; k < nVars; k++) {
+      int differingVariable = 1;
+      ExpTree d = duplicate(trees[i]);
+      differentiateTo(&d, program.names[k], &differingVariable);
+      partials[k] = compileExpTree(simplify(d));
+    }
+    resetArena(work);
+    useArena(NULL);
+    for (int p = 0; p < TEST_POINTS; p++) {
+      bindSlots(&program, p, vars);
+      double value = gradientProgram(&tape, vars, grad);
+      for (int k = 0; k < nVars; k++) {
+        columns[k][p] = vars[k];
+        pointGrads[k][p] = grad[k];
+        bindSlots(&partials[k], p, sub);
+        double expected = runProgram(&partials[k], sub);
+        if (!isfinite(value) || !isfinite(expected) || !isfinite(grad[k])) {
+          continue;
+        }
+        cases++;
+        if (!closeTo(expected, grad[k])) {
+          failures++;
+          showFailure("gradient", failures, trees[i], expected, grad[k]);
+        }
+      }
+    }
+    for (int k = 0; k < nVars; k++) {
+      columnPointers[k] = columns[k];
+      gradPointers[k] = rowGrads[k];
+    }
+    gradientRows(&tape, columnPointers, TEST_POINTS, values, gradPointers);
+    for (int k = 0; k < nVars; k++) {
+      cases++;
+      if (memcmp(rowGrads[k], pointGrads[k], sizeof(pointGrads[k])) != 0) {
+        failures++;
+        showFailure("gradient", failures, trees[i], pointGrads[k][0], rowGrads[k][0]);
+      }
+      freeProgram(&partials[k]);
+    }
+    freeTape(&tape);
+    freeProgram(&program);
+  }
+  return report("gradient", cases, failures);
+}
+
+// Writes all trees into a library file, opens it and compares what printExpTreeInfix prints for
+// every tree and for its formula expanded from the library
+static int checkLibrary(ExpTree *trees, int n, NodeArena *work) {
+  long cases = 0, failures = 0;
+  FILE *file = tmpfile();
+  FILE *printed = tmpfile();
+  if (file == NULL || printed == NULL) {
+    fprintf(stderr, "library: no temporary file\n");
+    return report("library", 0, 1);
+  }
+  LibraryWriter writer = newLibraryWriter();
+  for (int i = 0; i < n; i++) {
+    addLibraryFormula(&writer, trees[i]);
+  }
+  int written = writeLibrary(&writer, file);
+  freeLibraryWriter(&writer);
+  TreeLibrary library;
+  rewind(file);
+  if (!written || !openLibrary(&library, file)) {
+    fprintf(stderr, "library: the library cannot be written or opened\n");
+    fclose(file);
+    fclose(printed);
+    return report("library", 0, 1);
+  }
+  //printExpTreeInfix writes to stdout, which goes to the temporary file while the trees print,
+  //a line with the tree is followed by a line with the formula
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  dup2(fileno(printed), STDOUT_FILENO);
+  useArena(work);
+  for (int i = 0; i < n; i++) {
+    printExpTreeInfix(trees[i]);
+    putchar('\n');
+    ExpTree t = i < libraryFormulaCount(&library) ? expandLibraryFormula(&library, i) : NULL;
+    if (t != NULL) {
+      printExpTreeInfix(t);
+    }
+    putchar('\n');
+  }
+  resetArena(work);
+  useArena(NULL);
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+  closeLibrary(&library);
+  rewind(printed);
+  char *original = NULL, *line = NULL;
+  int originalSize = 0, size = 0;
+  for (int i = 0; i < n; i++) {
+    cases++;
+    if (!readLine(printed, &original, &originalSize) || !readLine(printed, &line, &size) ||
+        strcmp(original, line) != 0) {
+      failures++;
+      if (failures <= TEST_SHOWN && original != NULL && line != NULL) {
+        fprintf(stderr, "library: %s reads back as %s\n", original, line);
+      }
+    }
+  }
+  free(original);
+  free(line);
+  fclose(file);
+  fclose(printed);
+  return report("library", cases, failures);
+}
+
+// Returns a right nested tree like (x + (y * (z - ... x))) of depth levels, made in the active
+// arena. Its program needs a stack entry per level
+static ExpTree nestedTree(int depth) {
+  OutBuffer text = newOutBuffer(8 * depth + 16);
+  for (int i = 0; i < depth; i++) {
+    appendString(&text, i % 3 == 2 ? "2" : identifierPool[i % 5]);
+    appendChar(&text, ' ');
+    appendChar(&text, "+-*/"[i % 4]);
+    appendString(&text, " (");
+  }
+  appendChar(&text, 'x');
+  for (int i = 0; i < depth; i++) {
+    appendChar(&text, ')');
+  }
+  appendChar(&text, '\0');
+  List tl = tokenList(text.data);
+  List l = tl;
+  ExpTree t = NULL;
+  int errorPos;
+  parseInfixExpr(&l, &t, &errorPos);
+  freeTokenList(tl);
+  freeOutBuffer(&text);
+  return t;
+}
+
+// Compares the machine code of runJit with runProgram on the trees and on nested trees
+static int checkJit(ExpTree *trees, int n, NodeArena *work) {
+  long cases = 0, failures = 0;
+  double vars[TEST_SLOTS];
+  int deepCount = sizeof(jitDepths) / sizeof(jitDepths[0]);
+  useArena(work);
+  for (int i = 0; i < n + deepCount; i++) {
+    ExpTree tr = i < n ? trees[i] : nestedTree(jitDepths[i - n]);
+    if (tr == NULL) {
+      failures++;
+      continue;
+    }
+    JitCode jit = compileJit(tr);
+    //The slots of the machine code are those of its program
+    for (int p = 0; p < TEST_POINTS && bindSlots(&jit.program, p, vars); p++) {
+      double expected = runProgram(&jit.program, vars);
+      double actual = runJit(&jit, vars);
+      cases++;
+      if (memcmp(&expected, &actual, sizeof(double)) != 0) {
+        failures++;
+        showFailure("jit", failures, tr, expected, actual);
+      }
+    }
+    freeJit(&jit);
+  }
+  resetArena(work);
+  useArena(NULL);
+  return report("jit", cases, failures);
+}
+
+// Runs the pipeline on copies of the trees and on nested trees, each in the same arena that is
+// reset afterwards. Blocks are reused after a reset, so the arena mallocs as many blocks as the
+// largest expression needs and no node is malloc'ed on its own
+static int checkArena(ExpTree *trees, int n) {
+  long failures = 0, largest = 0;
+  int deepCount = sizeof(jitDepths) / sizeof(jitDepths[0]);
+  NodeArena arena = newArena();
+  long before = nodeMallocCount();
+  for (int i = 0; i < n + deepCount; i++) {
+    int differingVariable = 1;
+    useArena(&arena);
+    ExpTree t = i < n ? duplicate(trees[i]) : nestedTree(jitDepths[i - n]);
+    if (t != NULL) {
+      t = simplify(t);
+      differentiate(&t, &differingVariable);
+      simplify(t);
+    }
+    if (arena.nodeCount > largest) {
+      largest = arena.nodeCount;
+    }
+    resetArena(&arena);
+    useArena(NULL);
+  }
+  long blocks = (largest + ARENA_BLOCK_NODES - 1) / ARENA_BLOCK_NODES;
+  if (nodeMallocCount() != before) {
+    failures++;
+    fprintf(stderr, "arena: %ld nodes malloc'ed on their own\n", nodeMallocCount() - before);
+  }
+  if (arena.blockMallocs != blocks) {
+    failures++;
+    fprintf(stderr, "arena: %ld blocks malloc'ed instead of %ld\n", arena.blockMallocs, blocks);
+  }
+  freeArena(&arena);
+  return report("arena", n + deepCount, failures);
+}
+
+// Reads the options, returns 0 on a wrong one
+static int readOptions(int argc, char *argv[], int *count, unsigned long *seed) {
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      return 0;
+    }
+    if (strcmp(argv[i], "-n") == 0) {
+      *count = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-r") == 0) {
+      *seed = strtoul(argv[i + 1], NULL, 10);
+    } else {
+      return 0;
+    }
+    i++;
+  }
+  return *count > 0;
+}
+
+int main(int argc, char *argv[]) {
+  int count = 1000;
+  unsigned long seed = 1;
+  if (!readOptions(argc, argv, &count, &seed)) {
+    fprintf(stderr, "usage: %s [-n count] [-r seed]\n", argv[0]);
+    return 1;
+  }
+  NodeArena base = newArena();
+  NodeArena work = newArena();
+  int n;
+  useArena(&base);
+  ExpTree *trees = makeCorpus(count, seed, &n);
+  useArena(NULL);
+  int ok = 1;
+  ok &= checkBytecode(trees, n, &work);
+  ok &= checkGradients(trees, n, &work);
+  ok &= checkLibrary(trees, n, &work);
+  ok &= checkJit(trees, n, &work);
+  ok &= checkArena(trees, n);
+  free(trees);
+  freeArena(&base);
+  freeArena(&work);
+  freeSpareStacks();
+  return ok ? 0 : 1;
+}
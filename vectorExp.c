@@ -0,0 +1,159 @@
+/* file : vectorExp.c */
+/* authors : Vrincianu Andrei - Darius (a.vrincianu@student.rug.nl) and Vitalii Sikorski (v.sikorski@student.rug.nl) */
+/* date : October 16 2026 */
+/* version: 1.0 */
+
+/* Description:
+  Evaluates one expression for many rows of identifier values at once. The values are given
+  per identifier as a column (an array with one value per row). The expression is compiled to
+  bytecode and every instruction is applied to a block of VECTOR_BLOCK rows, using SSE2 or
+  AVX instructions when the compiler targets them. Each row gets exactly the result runProgram
+  would give for it.
+*/
+
+#include <stdio.h>  /* printf */
+#include <stdlib.h> /* malloc, free */
+#include <assert.h> /* assert */
+#include <string.h>
+#include "scanner.h"
+#include "prefixExp.h"
+#include "bytecodeExp.h"
+#include "symbolTable.h"
+#include "vectorExp.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VEC_WIDTH 4
+#define VecDouble __m256d
+#define vecLoad _mm256_loadu_pd
+#define vecStore _mm256_storeu_pd
+#define vecAdd _mm256_add_pd
+#define vecSub _mm256_sub_pd
+#define vecMul _mm256_mul_pd
+#define vecDiv _mm256_div_pd
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VEC_WIDTH 2
+#define VecDouble __m128d
+#define vecLoad _mm_loadu_pd
+#define vecStore _mm_storeu_pd
+#define vecAdd _mm_add_pd
+#define vecSub _mm_sub_pd
+#define vecMul _mm_mul_pd
+#define vecDiv _mm_div_pd
+#endif
+
+// Applies one operation to n rows: dst[i] = a[i] op b[i], dst may be a or b
+#ifdef VEC_WIDTH
+#define BLOCK_LOOP(vecOp, op) \
+  for (; i + VEC_WIDTH <= n; i += VEC_WIDTH) { \
+    VecDouble va = vecLoad(a + i); \
+    VecDouble vb = vecLoad(b + i); \
+    vecStore(dst + i, vecOp(va, vb)); \
+  } \
+  for (; i < n; i++) { \
+    dst[i] = a[i] op b[i]; \
+  }
+#else
+#define BLOCK_LOOP(vecOp, op) \
+  for (; i < n; i++) { \
+    dst[i] = a[i] op b[i]; \
+  }
+#endif
+
+static void blockOperation(OpCode op, double *dst, const double *a, const double *b, int n) {
+  int i = 0;
+  switch (op) {
+    case OpAdd:
+      BLOCK_LOOP(vecAdd, +)
+      break;
+    case OpSub:
+      BLOCK_LOOP(vecSub, -)
+      break;
+    case OpMul:
+      BLOCK_LOOP(vecMul, *)
+      break;
+    case OpDiv:
+      BLOCK_LOOP(vecDiv, /)
+      break;
+    default:
+      abort();
+  }
+}
+
+// Runs the program for rows rows, slot i of row r has the value columns[i][r].
+// The value of row r is stored in out[r]
+void runProgramColumns(Program *pp, const double **columns, int rows, double *out) {
+  //Every stack entry owns a block of scratch space, an entry pointing straight into a
+  //column is used for variables so they are never copied
+  double *scratch = malloc((size_t)pp->maxDepth * VECTOR_BLOCK * sizeof(double));
+  const double **entries = malloc(pp->maxDepth * sizeof(double *));
+  assert(scratch != NULL && entries != NULL);
+  for (int start = 0; start < rows; start += VECTOR_BLOCK) {
+    int n = rows - start < VECTOR_BLOCK ? rows - start : VECTOR_BLOCK;
+    int top = 0;
+    for (int k = 0; k < pp->length; k++) {
+      Instruction *ip = &pp->code[k];
+      double *block = scratch + (size_t)top * VECTOR_BLOCK;
+      switch (ip->op) {
+        case OpNumber:
+          for (int i = 0; i < n; i++) {
+            block[i] = ip->number;
+          }
+          entries[top] = block;
+          top++;
+          break;
+        case OpVariable:
+          entries[top] = columns[ip->slot] + start;
+          top++;
+          break;
+        default:
+          top--;
+          block = scratch + (size_t)(top - 1) * VECTOR_BLOCK;
+          blockOperation(ip->op, block, entries[top - 1], entries[top], n);
+          entries[top - 1] = block;
+          break;
+      }
+    }
+    memcpy(out + start, entries[0], n * sizeof(double));
+  }
+  free(scratch);
+  free(entries);
+}
+
+// Evaluates the tree for rows rows, identifier names[j] has the values columns[j].
+// The value of row r is stored in out[r]. Returns 0 if an identifier of the tree has no column
+int evalColumns(ExpTree tr, char **names, const double **columns, int nColumns, int rows, double *out) {
+  Program p = compileExpTree(tr);
+  //The columns are bound to identifiers by id, every slot then finds its column by indexing
+  int *ids = malloc((nColumns + 1) * sizeof(int));
+  assert(ids != NULL);
+  for (int j = 0; j < nColumns; j++) {
+    ids[j] = identifierId(internIdentifier(names[j], strlen(names[j])));
+  }
+  int *columnOfId = malloc(identifierCount() * sizeof(int));
+  const double **slotColumns = malloc((p.nameCount + 1) * sizeof(double *));
+  assert(columnOfId != NULL && slotColumns != NULL);
+  for (int i = 0; i < p.nameCount; i++) {
+    columnOfId[identifierId(p.names[i])] = -1;
+  }
+  for (int j = 0; j < nColumns; j++) {
+    columnOfId[ids[j]] = j;
+  }
+  free(ids);
+  for (int i = 0; i < p.nameCount; i++) {
+    int j = columnOfId[identifierId(p.names[i])];
+    slotColumns[i] = j < 0 ? NULL : columns[j];
+    if (slotColumns[i] == NULL) {
+      free(columnOfId);
+      free(slotColumns);
+      freeProgram(&p);
+      return 0;
+    }
+  }
+  runProgramColumns(&p, slotColumns, rows, out);
+  free(columnOfId);
+  free(slotColumns);
+  freeProgram(&p);
+  return 1;
+}
@@ -0,0 +1,14 @@
+#ifndef VECTOREXP_H
+#define VECTOREXP_H
+
+#include "scanner.h"
+#include "prefixExp.h"
+#include "bytecodeExp.h"
+
+// Number of rows every operation is applied to at once
+#define VECTOR_BLOCK 256
+
+void runProgramColumns(Program *pp, const double **columns, int rows, double *out);
+int evalColumns(ExpTree tr, char **names, const double **columns, int nColumns, int rows, double *out);
+
+#endif